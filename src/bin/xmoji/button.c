@@ -38,7 +38,7 @@ static void destroy(void *obj)
 {
     Button *self = obj;
     PSC_Event_destroy(self->clicked);
-    free(self);
+    Object_free(self);
 }
 
 static void expose(void *obj, Rect region)
@@ -146,7 +146,7 @@ static void originChanged(void *receiver, void *sender, void *args)
 
 Button *Button_createBase(void *derived, const char *name, void *parent)
 {
-    Button *self = PSC_malloc(sizeof *self);
+    Button *self = NEWOBJ(sizeof *self);
     CREATEBASE(Widget, name, parent);
     self->label = TextLabel_create(0, self);
     self->clicked = PSC_Event_create(self);
@@ -1,9 +1,11 @@
 #include "colorset.h"
 #include "x11adapter.h"
+#include "x11colors.h"
 #include "xrdb.h"
 
 #include <errno.h>
 #include <poser/core.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -54,6 +56,7 @@ static const char *reskeys[COLOR_NUMROLES][2] = {
 static int refcnt;
 static PSC_HashTable *colorCache;
 static PSC_HashTable *lookups;
+static char *serverKey;
 
 static const ColorSet defcolors = {
     .colors = {		// Color role	    X11 color name
@@ -81,6 +84,49 @@ static const ColorSet defcolors = {
     .npending = 0
 };
 
+/* Named colors the server resolved are kept in the user's cache directory,
+ * keyed by the X server, so they don't need a round trip on the next start.
+ * Lines are "<rrggbbaa>\t<server>\t<name>", a value of 1 means the server
+ * doesn't know the name. */
+static void readCache(void)
+{
+    char *name = X11Adapter_cacheFile("colors", 0);
+    if (!name) return;
+    FILE *f = fopen(name, "r");
+    free(name);
+    if (!f) return;
+    size_t keylen = strlen(serverKey);
+    char line[512];
+    while (fgets(line, sizeof line, f))
+    {
+	char *end;
+	unsigned long val = strtoul(line, &end, 16);
+	if (!val || *end++ != '\t') continue;
+	if (strncmp(end, serverKey, keylen) || end[keylen] != '\t') continue;
+	end += keylen + 1;
+	end[strcspn(end, "\n")] = 0;
+	if (!*end) continue;
+	if (!colorCache) colorCache = PSC_HashTable_create(6);
+	PSC_HashTable_set(colorCache, end, (void *)(uintptr_t)val, 0);
+    }
+    fclose(f);
+}
+
+static void writeCache(const char *colorname, uintptr_t colorval)
+{
+    if (strpbrk(colorname, "\t\n")) return;
+    char *name = X11Adapter_cacheFile("colors", 1);
+    if (!name) return;
+    FILE *f = fopen(name, "a");
+    if (f)
+    {
+	fprintf(f, "%08x\t%s\t%s\n", (unsigned)colorval, serverKey, colorname);
+	fclose(f);
+    }
+    else PSC_Log_fmt(PSC_L_WARNING, "Cannot write color cache `%s'", name);
+    free(name);
+}
+
 void destroyLookup(void *obj)
 {
     if (!obj) return;
@@ -109,6 +155,7 @@ static void colorReceived(void *obj, unsigned sequence,
 	self->targets[i].colorSet->colors[self->targets[i].role] = colorval;
     }
     if (!colorval) colorval = 1;
+    if (reply || error) writeCache(self->name, colorval);
     if (!colorCache) colorCache = PSC_HashTable_create(6);
     PSC_HashTable_set(colorCache, self->name, (void *)colorval, 0);
     PSC_HashTable_delete(lookups, self->name);
@@ -150,6 +197,8 @@ static void ColorSet_init(void)
     {
 	XRdb_register(rdb, reskeys[i][0], reskeys[i][1]);
     }
+    serverKey = X11Adapter_serverKey();
+    readCache();
 }
 
 static void ColorSet_done(void)
@@ -157,8 +206,10 @@ static void ColorSet_done(void)
     if (--refcnt) return;
     PSC_HashTable_destroy(lookups);
     PSC_HashTable_destroy(colorCache);
+    free(serverKey);
     lookups = 0;
     colorCache = 0;
+    serverKey = 0;
 }
 
 const ColorSet *ColorSet_default(void)
@@ -183,9 +234,10 @@ ColorSet *ColorSet_createFor(const char *name)
 	const char *colorstr = XRdb_value(rdb,
 		XRdbKey(name, reskeys[i][1]), XRQF_OVERRIDES);
 	if (!colorstr) continue;
-	if (Color_fromString(self->colors + i, colorstr) < 0)
+	if (Color_fromString(self->colors + i, colorstr) < 0
+		&& X11Colors_lookup(self->colors + i, colorstr) < 0)
 	{
-	    // Ask cache or server for a named X11 color
+	    // Ask cache or server for any other named color
 	    uintptr_t cached = 0;
 	    if (colorCache) cached = (uintptr_t)PSC_HashTable_get(
 		    colorCache, colorstr);
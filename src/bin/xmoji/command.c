@@ -52,13 +52,13 @@ static void destroy(void *obj)
     PSC_Event_destroy(self->triggered);
     UniStr_destroy(self->description);
     UniStr_destroy(self->name);
-    free(self);
+    Object_free(self);
 }
 
 Command *Command_createBase(void *derived,
 	const UniStr *name, const UniStr *description, void *parent)
 {
-    Command *self = PSC_malloc(sizeof *self);
+    Command *self = NEWOBJ(sizeof *self);
     CREATEBASE(Object);
     self->name = name ? UniStr_ref(name) : 0;
     self->description = description ? UniStr_ref(description) : 0;
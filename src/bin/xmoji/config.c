@@ -22,7 +22,9 @@
 #define DEF_INJECTORFLAGS   IF_NONE
 #define DEF_WAITBEFORE	    50
 #define DEF_WAITAFTER	    100
-#define DEF_SEARCHMODE	    ESM_TRANS
+#define DEF_SEARCHMODE	    (ESM_TRANS|ESM_KEYWORDS)
+#define DEF_PASTEKEYS	    "XTerm=Shift_L+Insert;URxvt=Shift_L+Insert;" \
+			    "*=Control_L+v"
 
 enum ConfigKey
 {
@@ -32,6 +34,8 @@ enum ConfigKey
     CFG_WAITBEFORE,
     CFG_WAITAFTER,
     CFG_SEARCHMODE,
+    CFG_SEARCHLANGUAGES,
+    CFG_PASTEKEYS,
     CFG_HISTORY
 };
 
@@ -42,6 +46,8 @@ static const char *keys[] = {
     "waitBefore",
     "waitAfter",
     "searchMode",
+    "searchLanguages",
+    "pasteKeys",
     "history"
 };
 
@@ -52,6 +58,8 @@ static void readInjectorFlags(Config *self);
 static void readWaitBefore(Config *self);
 static void readWaitAfter(Config *self);
 static void readSearchMode(Config *self);
+static void readSearchLanguages(Config *self);
+static void readPasteKeys(Config *self);
 
 static void (*const readers[])(Config *) = {
     readSingleInstance,
@@ -60,6 +68,8 @@ static void (*const readers[])(Config *) = {
     readWaitBefore,
     readWaitAfter,
     readSearchMode,
+    readSearchLanguages,
+    readPasteKeys,
     readHistory
 };
 
@@ -76,6 +86,8 @@ struct Config
     unsigned waitBefore;
     unsigned waitAfter;
     EmojiSearchMode searchMode;
+    char *searchLanguages;
+    char *pasteKeys;
 };
 
 static void readHistory(Config *self)
@@ -150,7 +162,10 @@ static void readInjectorFlags(Config *self)
     if (tryParseNum(&flagsval,
 		ConfigFile_get(self->cfg, keys[CFG_INJECTORFLAGS])))
     {
-	if (flagsval & ~(IF_ADDSPACE|IF_ADDZWSPACE|IF_EXTRAZWJ)) goto done;
+	if (flagsval & ~(IF_ADDSPACE|IF_ADDZWSPACE|IF_EXTRAZWJ|IF_PASTE))
+	{
+	    goto done;
+	}
 	if ((flagsval & (IF_ADDSPACE|IF_ADDZWSPACE))
 		== (IF_ADDSPACE|IF_ADDZWSPACE)) goto done;
 	flags = flagsval;
@@ -212,8 +227,9 @@ static void readSearchMode(Config *self)
     EmojiSearchMode mode = DEF_SEARCHMODE;
     long modeval;
     if (tryParseNum(&modeval, ConfigFile_get(self->cfg, keys[CFG_SEARCHMODE]))
-	    && modeval >= ESM_ORIG && modeval <= (ESM_FULL|ESM_TRANS|ESM_ORIG)
-	    && modeval != ESM_FULL)
+	    && modeval >= ESM_ORIG
+	    && modeval <= (ESM_KEYWORDS|ESM_FULL|ESM_TRANS|ESM_ORIG)
+	    && (modeval & (ESM_TRANS|ESM_ORIG)))
     {
 	mode = modeval;
     }
@@ -228,6 +244,41 @@ static void readSearchMode(Config *self)
     }
 }
 
+static void readSearchLanguages(Config *self)
+{
+    const char *languages = ConfigFile_get(self->cfg,
+	    keys[CFG_SEARCHLANGUAGES]);
+    if (languages && !*languages) languages = 0;
+    if (self->reading == 2 || (languages ? !self->searchLanguages
+		|| strcmp(languages, self->searchLanguages)
+		: !!self->searchLanguages))
+    {
+	free(self->searchLanguages);
+	self->searchLanguages = languages ? PSC_copystr(languages) : 0;
+	if (self->reading < 2)
+	{
+	    ConfigChangedEventArgs ea = { 1 };
+	    PSC_Event_raise(self->changed[CFG_SEARCHLANGUAGES], 0, &ea);
+	}
+    }
+}
+
+static void readPasteKeys(Config *self)
+{
+    const char *pasteKeys = ConfigFile_get(self->cfg, keys[CFG_PASTEKEYS]);
+    if (!pasteKeys || !*pasteKeys) pasteKeys = DEF_PASTEKEYS;
+    if (self->reading == 2 || strcmp(pasteKeys, self->pasteKeys))
+    {
+	free(self->pasteKeys);
+	self->pasteKeys = PSC_copystr(pasteKeys);
+	if (self->reading < 2)
+	{
+	    ConfigChangedEventArgs ea = { 1 };
+	    PSC_Event_raise(self->changed[CFG_PASTEKEYS], 0, &ea);
+	}
+    }
+}
+
 static void filechanged(void *receiver, void *sender, void *args)
 {
     (void)sender;
@@ -385,6 +436,8 @@ static char *defname(void)
 Config *Config_create(const char *path)
 {
     Config *self = PSC_malloc(sizeof *self);
+    self->searchLanguages = 0;
+    self->pasteKeys = 0;
     self->cfgfile = path ? canonicalpath(path) : 0;
     if (!self->cfgfile)
     {
@@ -478,7 +531,7 @@ InjectorFlags Config_injectorFlags(const Config *self)
 void Config_setInjectorFlags(Config *self, InjectorFlags flags)
 {
     if (self->injectorFlags == flags) return;
-    if (flags & ~(IF_ADDSPACE|IF_ADDZWSPACE|IF_EXTRAZWJ)) return;
+    if (flags & ~(IF_ADDSPACE|IF_ADDZWSPACE|IF_EXTRAZWJ|IF_PASTE)) return;
     if ((flags & (IF_ADDSPACE|IF_ADDZWSPACE))
 	    == (IF_ADDSPACE|IF_ADDZWSPACE)) return;
     writeNum(self, CFG_INJECTORFLAGS, flags);
@@ -541,8 +594,8 @@ void Config_setEmojiSearchMode(Config *self, EmojiSearchMode mode)
 {
     if (self->searchMode == mode) return;
     if ((int)mode < (int)ESM_ORIG
-	    || (int)mode > (int)(ESM_FULL|ESM_ORIG|ESM_TRANS)
-	    || (int)mode == ESM_FULL) return;
+	    || (int)mode > (int)(ESM_KEYWORDS|ESM_FULL|ESM_ORIG|ESM_TRANS)
+	    || !(mode & (ESM_ORIG|ESM_TRANS))) return;
     writeNum(self, CFG_SEARCHMODE, mode);
     self->searchMode = mode;
     ConfigChangedEventArgs ea = { 0 };
@@ -554,6 +607,26 @@ PSC_Event *Config_emojiSearchModeChanged(Config *self)
     return self->changed[CFG_SEARCHMODE];
 }
 
+const char *Config_searchLanguages(const Config *self)
+{
+    return self->searchLanguages;
+}
+
+PSC_Event *Config_searchLanguagesChanged(Config *self)
+{
+    return self->changed[CFG_SEARCHLANGUAGES];
+}
+
+const char *Config_pasteKeys(const Config *self)
+{
+    return self->pasteKeys;
+}
+
+PSC_Event *Config_pasteKeysChanged(Config *self)
+{
+    return self->changed[CFG_PASTEKEYS];
+}
+
 void Config_destroy(Config *self)
 {
     if (!self) return;
@@ -563,6 +636,8 @@ void Config_destroy(Config *self)
     {
 	PSC_Event_destroy(self->changed[i]);
     }
+    free(self->searchLanguages);
+    free(self->pasteKeys);
     free(self->cfgfile);
     free(self);
 }
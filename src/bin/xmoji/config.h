@@ -44,6 +44,13 @@ EmojiSearchMode Config_emojiSearchMode(const Config *self) CMETHOD;
 void Config_setEmojiSearchMode(Config *self, EmojiSearchMode mode) CMETHOD;
 PSC_Event *Config_emojiSearchModeChanged(Config *self) CMETHOD ATTR_RETNONNULL;
 
+const char *Config_searchLanguages(const Config *self) CMETHOD;
+PSC_Event *Config_searchLanguagesChanged(Config *self)
+    CMETHOD ATTR_RETNONNULL;
+
+const char *Config_pasteKeys(const Config *self) CMETHOD ATTR_RETNONNULL;
+PSC_Event *Config_pasteKeysChanged(Config *self) CMETHOD ATTR_RETNONNULL;
+
 void Config_destroy(Config *self);
 
 #endif
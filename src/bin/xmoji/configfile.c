@@ -1,10 +1,11 @@
-#define _POSIX_C_SOURCE 200112L
+#define _POSIX_C_SOURCE 200809L
 
 #include "configfile.h"
 
 #include "filewatcher.h"
 
 #include <poser/core.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,13 +13,16 @@
 #include <unistd.h>
 
 #define TMPSUFX ".tmp"
+#define WRITEDELAYMS 500
 
 typedef struct ReadContext
 {
     ConfigFile *configFile;
     PSC_ThreadJob *job;
+    struct stat written;
     int rc;
     int checkchanges;
+    int checkwritten;
     char buf[8192];
     char *vals[];
 } ReadContext;
@@ -28,7 +32,11 @@ typedef struct WriteContext
     ConfigFile *configFile;
     char *tmppath;
     PSC_ThreadJob *job;
+    pthread_mutex_t lock;
+    pthread_cond_t jobdone;
+    struct stat written;
     int rc;
+    int done;
     char *vals[];
 } WriteContext;
 
@@ -40,8 +48,12 @@ struct ConfigFile
     const char **keys;
     ReadContext *readContext;
     WriteContext *writeContext;
+    PSC_Timer *writeTimer;
+    struct stat written;
     size_t nkeys;
     int dirty;
+    int writeScheduled;
+    int haveWritten;
     char *vals[];
 };
 
@@ -74,11 +86,28 @@ static int parseline(char *buf, const char **key, const char **val)
     return 1;
 }
 
+/* Compare to the file we wrote last, so our own writes aren't parsed again
+ * when they are reported as changes */
+static int iswritten(const struct stat *st, const struct stat *written)
+{
+    return st->st_dev == written->st_dev && st->st_ino == written->st_ino
+	&& st->st_size == written->st_size
+	&& st->st_mtim.tv_sec == written->st_mtim.tv_sec
+	&& st->st_mtim.tv_nsec == written->st_mtim.tv_nsec;
+}
+
 static void readjob(void *arg)
 {
     ReadContext *ctx = arg;
     FILE *f = fopen(ctx->configFile->path, "r");
     if (!f || (ctx->job && PSC_ThreadJob_canceled())) goto done;
+    struct stat st;
+    if (ctx->checkwritten && fstat(fileno(f), &st) >= 0
+	    && iswritten(&st, &ctx->written))
+    {
+	ctx->rc = 1;
+	goto done;
+    }
     while (fgets(ctx->buf, sizeof ctx->buf, f))
     {
 	if (ctx->job && PSC_ThreadJob_canceled()) goto done;
@@ -161,6 +190,8 @@ static int doread(ConfigFile *self, int checkchanges)
     self->readContext->configFile = self;
     self->readContext->rc = -1;
     self->readContext->checkchanges = checkchanges;
+    self->readContext->checkwritten = self->haveWritten;
+    self->readContext->written = self->written;
 
     if (checkchanges && PSC_ThreadPool_active())
     {
@@ -227,7 +258,11 @@ ConfigFile *ConfigFile_create(const char *path, size_t nkeys,
     self->keys = keys;
     self->readContext = 0;
     self->writeContext = 0;
+    self->writeTimer = 0;
     self->nkeys = nkeys;
+    self->dirty = 0;
+    self->writeScheduled = 0;
+    self->haveWritten = 0;
     memset(self->vals, 0, nkeys * sizeof *self->vals);
     PSC_Event_register(FileWatcher_changed(self->watcher), self,
 	    filechanged, 0);
@@ -276,6 +311,26 @@ done:
     return rc;
 }
 
+static void writejobdone(WriteContext *ctx)
+{
+    pthread_mutex_lock(&ctx->lock);
+    ctx->done = 1;
+    pthread_cond_signal(&ctx->jobdone);
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+static void freewritecontext(ConfigFile *self, WriteContext *ctx)
+{
+    pthread_cond_destroy(&ctx->jobdone);
+    pthread_mutex_destroy(&ctx->lock);
+    free(ctx->tmppath);
+    for (size_t i = 0; i < self->nkeys; ++i)
+    {
+	free(ctx->vals[i]);
+    }
+    free(ctx);
+}
+
 static void movejobfinished(void *receiver, void *sender, void *args)
 {
     (void)sender;
@@ -284,19 +339,29 @@ static void movejobfinished(void *receiver, void *sender, void *args)
     WriteContext *ctx = args;
 
     FileWatcher_watch(self->watcher);
-    if (self->writeContext == ctx) self->writeContext = 0;
-    free(ctx->tmppath);
-    for (size_t i = 0; i < self->nkeys; ++i)
+    if (ctx->rc == 0)
     {
-	free(ctx->vals[i]);
+	self->written = ctx->written;
+	self->haveWritten = 1;
     }
-    free(ctx);
+    if (self->writeContext == ctx)
+    {
+	self->writeContext = 0;
+	if (self->dirty && !self->writeScheduled)
+	{
+	    self->writeScheduled = 1;
+	    PSC_Timer_start(self->writeTimer, 0);
+	}
+    }
+    freewritecontext(self, ctx);
 }
 
 static void movejob(void *arg)
 {
     WriteContext *ctx = arg;
-    if (rename(ctx->tmppath, ctx->configFile->path) >= 0) ctx->rc = 0;
+    if (rename(ctx->tmppath, ctx->configFile->path) >= 0
+	    && stat(ctx->configFile->path, &ctx->written) >= 0) ctx->rc = 0;
+    if (ctx->job) writejobdone(ctx);
 }
 
 static void writejobfinished(void *receiver, void *sender, void *args)
@@ -310,6 +375,7 @@ static void writejobfinished(void *receiver, void *sender, void *args)
 	FileWatcher_unwatch(self->watcher);
 	if (job)
 	{
+	    ctx->done = 0;
 	    ctx->job = PSC_ThreadJob_create(movejob, ctx, 0);
 	    PSC_Event_register(PSC_ThreadJob_finished(ctx->job),
 		    self, movejobfinished, 0);
@@ -345,16 +411,13 @@ done:
 	fclose(f);
 	if (ctx->rc < -1) unlink(ctx->tmppath);
     }
-    if (!ctx->job) writejobfinished(ctx->configFile, 0, ctx);
+    if (ctx->job) writejobdone(ctx);
+    else writejobfinished(ctx->configFile, 0, ctx);
 }
 
-int ConfigFile_write(ConfigFile *self, int sync)
+static int startwrite(ConfigFile *self, int sync)
 {
-    if (self->writeContext)
-    {
-	PSC_ThreadPool_cancel(self->writeContext->job);
-    }
-
+    self->dirty = 0;
     self->writeContext = PSC_malloc(sizeof *self->writeContext
 	    + self->nkeys * sizeof *self->writeContext->vals);
     self->writeContext->configFile = self;
@@ -362,7 +425,10 @@ int ConfigFile_write(ConfigFile *self, int sync)
     self->writeContext->tmppath = PSC_malloc(nmlen + sizeof TMPSUFX);
     memcpy(self->writeContext->tmppath, self->path, nmlen);
     memcpy(self->writeContext->tmppath+nmlen, TMPSUFX, sizeof TMPSUFX);
+    pthread_mutex_init(&self->writeContext->lock, 0);
+    pthread_cond_init(&self->writeContext->jobdone, 0);
     self->writeContext->rc = -2;
+    self->writeContext->done = 0;
     for (size_t i = 0; i < self->nkeys; ++i)
     {
 	self->writeContext->vals[i] = self->vals[i]
@@ -386,9 +452,74 @@ int ConfigFile_write(ConfigFile *self, int sync)
     return rc;
 }
 
+static void writetimeout(void *receiver, void *sender, void *args)
+{
+    (void)sender;
+    (void)args;
+
+    ConfigFile *self = receiver;
+    self->writeScheduled = 0;
+    if (!self->dirty || self->writeContext) return;
+    startwrite(self, 0);
+}
+
+/* Cancel a write in progress and wait until its thread is done with the
+ * files, so it can't interfere with a synchronous write. Its result is
+ * discarded, the synchronous write has all current values anyways. */
+static void abandonwrite(ConfigFile *self)
+{
+    WriteContext *ctx = self->writeContext;
+    PSC_ThreadPool_cancel(ctx->job);
+
+    /* A job canceled before it started is already finished now */
+    if (self->writeContext != ctx) return;
+
+    pthread_mutex_lock(&ctx->lock);
+    while (!ctx->done) pthread_cond_wait(&ctx->jobdone, &ctx->lock);
+    pthread_mutex_unlock(&ctx->lock);
+    PSC_Event_unregister(PSC_ThreadJob_finished(ctx->job), self,
+	    writejobfinished, 0);
+    PSC_Event_unregister(PSC_ThreadJob_finished(ctx->job), self,
+	    movejobfinished, 0);
+    self->writeContext = 0;
+    freewritecontext(self, ctx);
+}
+
+/* Asynchronous writes are coalesced: they only mark the file dirty and
+ * schedule a write after a short delay, and a write still in progress
+ * schedules the next one when it completes */
+int ConfigFile_write(ConfigFile *self, int sync)
+{
+    if (sync)
+    {
+	if (self->writeScheduled)
+	{
+	    PSC_Timer_stop(self->writeTimer);
+	    self->writeScheduled = 0;
+	}
+	if (self->writeContext) abandonwrite(self);
+	return startwrite(self, 1);
+    }
+
+    self->dirty = 1;
+    if (self->writeScheduled || self->writeContext) return 0;
+    if (!self->writeTimer)
+    {
+	self->writeTimer = PSC_Timer_create();
+	PSC_Timer_setMs(self->writeTimer, WRITEDELAYMS);
+	PSC_Event_register(PSC_Timer_expired(self->writeTimer), self,
+		writetimeout, 0);
+    }
+    self->writeScheduled = 1;
+    PSC_Timer_start(self->writeTimer, 0);
+    return 0;
+}
+
 void ConfigFile_destroy(ConfigFile *self)
 {
     if (!self) return;
+    if (self->dirty || self->writeContext) ConfigFile_write(self, 1);
+    PSC_Timer_destroy(self->writeTimer);
     clearvals(self, 0);
     PSC_Event_destroy(self->changed);
     FileWatcher_destroy(self->watcher);
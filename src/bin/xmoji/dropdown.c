@@ -37,7 +37,7 @@ static void destroy(void *obj)
     Shape_destroy(self->arrow);
     Pen_destroy(self->pen);
     PSC_Event_destroy(self->selected);
-    free(self);
+    Object_free(self);
 }
 
 static xcb_render_picture_t renderArrow(void *obj,
@@ -132,7 +132,7 @@ static int clicked(void *obj, const ClickEvent *event)
 
 Dropdown *Dropdown_createBase(void *derived, const char *name, void *parent)
 {
-    Dropdown *self = PSC_malloc(sizeof *self);
+    Dropdown *self = NEWOBJ(sizeof *self);
     CREATEBASE(Button, name, parent);
     self->selected = PSC_Event_create(self);
     self->pen = 0;
@@ -6,15 +6,16 @@
 
 C_CLASS_DECL(Emoji);
 C_CLASS_DECL(EmojiGroup);
-C_CLASS_DECL(Translator);
 C_CLASS_DECL(UniStr);
 
 typedef enum EmojiSearchMode
 {
     ESM_NONE	= 0,
     ESM_ORIG	= 1 << 0,   // search in original (english) names
-    ESM_TRANS	= 1 << 1,   // search in translated names (current locale)
-    ESM_FULL	= 1 << 2    // search in text after colon
+    ESM_TRANS	= 1 << 1,   // search in translated names (current locale
+			    // and additional search languages)
+    ESM_FULL	= 1 << 2,   // search in text after colon
+    ESM_KEYWORDS	= 1 << 3    // also match CLDR keywords exactly
 } EmojiSearchMode;
 
 size_t EmojiGroup_numGroups(void) ATTR_CONST;
@@ -30,9 +31,6 @@ const EmojiGroup *Emoji_group(const Emoji *self) CMETHOD ATTR_PURE;
 const UniStr *Emoji_str(const Emoji *self) CMETHOD ATTR_PURE;
 unsigned Emoji_name(const Emoji *self) CMETHOD ATTR_PURE;
 unsigned Emoji_variants(const Emoji *self) CMETHOD ATTR_PURE;
-size_t Emoji_search(const Emoji **results, size_t resultsz, size_t maxresults,
-	const UniStr *pattern, const Translator *tr, EmojiSearchMode mode)
-    ATTR_NONNULL((1)) ATTR_NONNULL((4)) ATTR_NONNULL((5));
 
 const void *XME_get(unsigned id);
 
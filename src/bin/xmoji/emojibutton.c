@@ -21,6 +21,7 @@ static int draw(void *obj, xcb_render_picture_t picture);
 static void unselect(void *obj);
 static void setFont(void *obj, Font *font);
 static int clicked(void *obj, const ClickEvent *event);
+static void syncFlyout(EmojiButton *self);
 
 static MetaEmojiButton mo = MetaEmojiButton_init(
 	0, draw, 0, 0, 0, 0, 0, 0, 0, 0, 0, unselect, setFont,
@@ -35,12 +36,16 @@ struct EmojiButton
     PSC_Event *pasted;
     FlowGrid *flowgrid;
     Flyout *flyout;
+    EmojiButton **buttons;
     Shape *triangle;
     Pen *pen;
     Size trianglesize;
     int selected;
+    int fontPending;
+    int nbuttons;
+    int synced;
     int nvariants;
-    EmojiButton *variants[];
+    const Emoji *variants[];
 };
 
 static void destroy(void *obj)
@@ -48,9 +53,10 @@ static void destroy(void *obj)
     EmojiButton *self = obj;
     Pen_destroy(self->pen);
     Shape_destroy(self->triangle);
+    free(self->buttons);
     PSC_Event_destroy(self->pasted);
     PSC_Event_destroy(self->injected);
-    free(self);
+    Object_free(self);
 }
 
 static void renderCallback(void *ctx, TextRenderer *renderer)
@@ -188,7 +194,7 @@ static void setFont(void *obj, Font *font)
 {
     EmojiButton *self = Object_instance(obj);
     Object_bcallv(Widget, setFont, self, font);
-    if (self->flowgrid) Widget_setFont(self->flowgrid, font);
+    if (self->flowgrid) self->fontPending = 1;
 }
 
 static int clicked(void *obj, const ClickEvent *event)
@@ -205,6 +211,12 @@ static int clicked(void *obj, const ClickEvent *event)
     }
     if (self->nvariants > 0 && event->button == MB_RIGHT)
     {
+	syncFlyout(self);
+	if (self->fontPending)
+	{
+	    Widget_setFont(self->flowgrid, Widget_font(self));
+	    self->fontPending = 0;
+	}
 	Widget_show(self->flowgrid);
 	Flyout_popup(self->flyout, self);
 	return 1;
@@ -247,7 +259,7 @@ static void sizeChanged(void *receiver, void *sender, void *args)
 static EmojiButton *create(size_t maxvariants, void *derived,
 	const char *name, const Translator *tr, void *parent)
 {
-    EmojiButton *self = PSC_malloc(sizeof *self
+    EmojiButton *self = NEWOBJ(sizeof *self
 	    + maxvariants * sizeof *self->variants);
     memset(self, 0, sizeof *self + maxvariants * sizeof *self->variants);
     CREATEBASE(Button, name, parent);
@@ -272,6 +284,42 @@ static EmojiButton *create(size_t maxvariants, void *derived,
     return self;
 }
 
+static void syncFlyout(EmojiButton *self)
+{
+    if (self->synced) return;
+    if (!self->flyout)
+    {
+	self->flyout = Flyout_create(0, self);
+	self->flowgrid = FlowGrid_create(self);
+	FlowGrid_setSpacing(self->flowgrid, (Size){0, 0});
+	Widget_setPadding(self->flowgrid, (Box){0, 0, 0, 0});
+	Widget_setBackground(self->flowgrid, 1, COLOR_BG_NORMAL);
+	Flyout_setWidget(self->flyout, self->flowgrid);
+	Font *font = Widget_font(self);
+	if (font) Widget_setFont(self->flowgrid, font);
+	self->buttons = PSC_malloc(MAXEMOJIVARIANTS * sizeof *self->buttons);
+	self->fontPending = 0;
+    }
+    for (int i = 0; i < self->nvariants; ++i)
+    {
+	if (i == self->nbuttons)
+	{
+	    EmojiButton *vb = create(0, 0, 0, self->tr, self);
+	    PSC_Event_register(Button_clicked(vb), self, onclicked, 0);
+	    PSC_Event_register(Widget_pasted(vb), self, onpasted, 0);
+	    self->buttons[self->nbuttons++] = vb;
+	    FlowGrid_addWidget(self->flowgrid, vb);
+	}
+	EmojiButton_setEmoji(self->buttons[i], self->variants[i]);
+	Widget_show(self->buttons[i]);
+    }
+    for (int i = self->nvariants; i < self->nbuttons; ++i)
+    {
+	Widget_hide(self->buttons[i]);
+    }
+    self->synced = 1;
+}
+
 EmojiButton *EmojiButton_createBase(void *derived,
 	const char *name, const Translator *tr, int variants, void *parent)
 {
@@ -303,39 +351,14 @@ void EmojiButton_addVariant(void *self, const Emoji *variant)
 {
     EmojiButton *b = Object_instance(self);
     if (b->nvariants < 0 || b->nvariants == MAXEMOJIVARIANTS) return;
-    if (!b->flyout)
-    {
-	b->flyout = Flyout_create(0, b);
-	b->flowgrid = FlowGrid_create(b);
-	FlowGrid_setSpacing(b->flowgrid, (Size){0, 0});
-	Widget_setPadding(b->flowgrid, (Box){0, 0, 0, 0});
-	Widget_setFont(b->flowgrid, Widget_font(b));
-	Widget_setBackground(b->flowgrid, 1, COLOR_BG_NORMAL);
-	Flyout_setWidget(b->flyout, b->flowgrid);
-	Font *font = Widget_font(b);
-	if (font) Widget_setFont(b->flowgrid, font);
-    }
-    EmojiButton *vb = b->variants[b->nvariants];
-    if (!vb)
-    {
-	vb = create(0, 0, 0, b->tr, b);
-	PSC_Event_register(Button_clicked(vb), self, onclicked, 0);
-	PSC_Event_register(Widget_pasted(vb), self, onpasted, 0);
-	b->variants[b->nvariants] = vb;
-	FlowGrid_addWidget(b->flowgrid, vb);
-    }
-    EmojiButton_setEmoji(vb, variant);
-    Widget_show(vb);
-    ++b->nvariants;
+    b->variants[b->nvariants++] = variant;
+    b->synced = 0;
 }
 
 void EmojiButton_clearVariants(void *self)
 {
     EmojiButton *b = Object_instance(self);
     if (b->nvariants <= 0) return;
-    for (int i = 0; i < b->nvariants; ++i)
-    {
-	Widget_hide(b->variants[i]);
-    }
     b->nvariants = 0;
+    b->synced = 0;
 }
@@ -0,0 +1,153 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "emojikeywords.h"
+
+#include <poser/core.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WITH_NLS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define KWNAME "xmoji-keywords"
+#define KWVERSION 1
+#define HEADERSZ 16
+#define SLOTSZ 16
+#endif
+
+struct EmojiKeywords
+{
+    const unsigned char *map;
+    size_t mapsz;
+    uint32_t nkeywords;
+    uint32_t nbuckets;
+};
+
+#ifdef WITH_NLS
+static uint32_t get32le(const unsigned char *data)
+{
+    return data[0] + (data[1] << 8) + (data[2] << 16)
+	+ ((uint32_t)data[3] << 24);
+}
+
+/* Must match the hash used by emojigen to build the table */
+static uint32_t kwhash(const char32_t *s, size_t len, uint32_t seed)
+{
+    uint32_t h = 2166136261U ^ (seed * 0x9e3779b9U);
+    for (size_t i = 0; i < len; ++i)
+    {
+	h ^= (uint32_t)s[i];
+	h *= 16777619U;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    return h;
+}
+
+static char *kwfilename(const char *lang)
+{
+    size_t langlen = strcspn(lang, "_.@");
+    size_t len = sizeof TRANSDIR + sizeof KWNAME + langlen + 5;
+    char *name = PSC_malloc(len);
+    snprintf(name, len, TRANSDIR "/" KWNAME "-%.*s.xkw", (int)langlen, lang);
+    return name;
+}
+#endif
+
+EmojiKeywords *EmojiKeywords_create(const char *lang)
+{
+#ifdef WITH_NLS
+    EmojiKeywords *self = 0;
+    char *name = kwfilename(lang);
+    int fd = open(name, O_RDONLY);
+    free(name);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < HEADERSZ) goto done;
+    size_t sz = st.st_size;
+    unsigned char *map = mmap(0, sz, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) goto done;
+    uint32_t n = get32le(map + 4);
+    uint32_t m = get32le(map + 8);
+    if (memcmp(map, "XKW", 3) || map[3] != KWVERSION || !m
+	    || (sz - HEADERSZ) / 4 < m
+	    || (sz - HEADERSZ - 4 * (size_t)m) / SLOTSZ < n)
+    {
+	munmap(map, sz);
+	goto done;
+    }
+    self = PSC_malloc(sizeof *self);
+    self->map = map;
+    self->mapsz = sz;
+    self->nkeywords = n;
+    self->nbuckets = m;
+done:
+    close(fd);
+    return self;
+#else
+    (void)lang;
+    return 0;
+#endif
+}
+
+size_t EmojiKeywords_match(const EmojiKeywords *self, const char32_t *keyword,
+	size_t len, unsigned char *hits, size_t nhits)
+{
+#ifdef WITH_NLS
+    if (!self->nkeywords) return 0;
+    uint32_t bucket = kwhash(keyword, len, 0) % self->nbuckets;
+    uint32_t disp = get32le(self->map + HEADERSZ + 4 * (size_t)bucket);
+    if (!disp) return 0;
+    uint32_t slot = kwhash(keyword, len, disp) % self->nkeywords;
+    const unsigned char *entry = self->map + HEADERSZ
+	+ 4 * (size_t)self->nbuckets + SLOTSZ * (size_t)slot;
+    size_t keyoff = get32le(entry);
+    size_t keylen = get32le(entry + 4);
+    size_t emojisoff = get32le(entry + 8);
+    size_t nemojis = get32le(entry + 12);
+    if (keylen != len || keyoff > self->mapsz
+	    || (self->mapsz - keyoff) / 4 < keylen
+	    || emojisoff > self->mapsz
+	    || (self->mapsz - emojisoff) / 4 < nemojis) return 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+	if (get32le(self->map + keyoff + 4 * i) != (uint32_t)keyword[i])
+	{
+	    return 0;
+	}
+    }
+    size_t matched = 0;
+    for (size_t i = 0; i < nemojis; ++i)
+    {
+	uint32_t emoji = get32le(self->map + emojisoff + 4 * i);
+	if (emoji < nhits && !hits[emoji])
+	{
+	    hits[emoji] = 1;
+	    ++matched;
+	}
+    }
+    return matched;
+#else
+    (void)self;
+    (void)keyword;
+    (void)len;
+    (void)hits;
+    (void)nhits;
+    return 0;
+#endif
+}
+
+void EmojiKeywords_destroy(EmojiKeywords *self)
+{
+    if (!self) return;
+#ifdef WITH_NLS
+    munmap((void *)self->map, self->mapsz);
+#endif
+    free(self);
+}
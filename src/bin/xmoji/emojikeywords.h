@@ -0,0 +1,18 @@
+#ifndef XMOJI_EMOJIKEYWORDS_H
+#define XMOJI_EMOJIKEYWORDS_H
+
+#include "char32.h"
+
+#include <poser/decl.h>
+#include <stddef.h>
+
+C_CLASS_DECL(EmojiKeywords);
+
+EmojiKeywords *EmojiKeywords_create(const char *lang)
+    ATTR_NONNULL((1));
+size_t EmojiKeywords_match(const EmojiKeywords *self, const char32_t *keyword,
+	size_t len, unsigned char *hits, size_t nhits)
+    CMETHOD ATTR_NONNULL((2)) ATTR_NONNULL((4));
+void EmojiKeywords_destroy(EmojiKeywords *self);
+
+#endif
@@ -0,0 +1,434 @@
+#include "emojisearch.h"
+
+#include "emojikeywords.h"
+#include "translator.h"
+#include "unistr.h"
+
+#include <poser/core.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EMOJITEXTS "xmoji-emojis"
+#define ORIGLANG "en"
+#define HASHBITS 12
+#define LANGDELIMS " \t,;"
+
+typedef struct SearchEntry
+{
+    const char32_t *lc;
+    uint32_t len;
+    uint32_t baselen;
+    uint32_t emoji;
+    int translated;
+} SearchEntry;
+
+typedef struct Posting
+{
+    uint32_t *ids;
+    uint32_t len;
+    uint32_t capa;
+} Posting;
+
+typedef struct SearchSource
+{
+    Translator *tr;
+    EmojiKeywords *keywords;
+    char *lang;
+    char32_t *pool;
+    int translated;
+    int indexed;
+    int kwloaded;
+} SearchSource;
+
+/* All emoji names of all sources (original names, the current locale and
+ * any additional languages) are kept lowercased in one list of entries.
+ * A hash of all trigrams points to the entries containing them, so a
+ * search only has to check the entries of the pattern's rarest trigram,
+ * regardless of the number of languages. Keywords are looked up in the
+ * perfect hash tables generated from CLDR annotations instead.
+ * Once prepared for a search mode, matching only reads all this, so it
+ * can run in a thread job. */
+struct EmojiSearch
+{
+    const Translator *tr;
+    char *lang;
+    char *languages;
+    SearchSource *sources;
+    size_t nsources;
+    SearchEntry *entries;
+    size_t nentries;
+    size_t entriescapa;
+    uint64_t *keys;
+    Posting *postings;
+    unsigned hashbits;
+    size_t hashused;
+};
+
+static uint64_t trigram(const char32_t *str)
+{
+    return ((uint64_t)(str[0] & 0x1fffffU) << 42)
+	| ((uint64_t)(str[1] & 0x1fffffU) << 21)
+	| (uint64_t)(str[2] & 0x1fffffU);
+}
+
+static size_t hashpos(uint64_t key, unsigned bits)
+{
+    return (size_t)((key * 0x9e3779b97f4a7c15ULL) >> (64 - bits));
+}
+
+static void inithash(EmojiSearch *self, unsigned bits)
+{
+    size_t size = (size_t)1 << bits;
+    self->keys = PSC_malloc(size * sizeof *self->keys);
+    memset(self->keys, 0, size * sizeof *self->keys);
+    self->postings = PSC_malloc(size * sizeof *self->postings);
+    self->hashbits = bits;
+    self->hashused = 0;
+}
+
+static Posting *posting(EmojiSearch *self, uint64_t key);
+
+static void growhash(EmojiSearch *self)
+{
+    uint64_t *keys = self->keys;
+    Posting *postings = self->postings;
+    size_t size = (size_t)1 << self->hashbits;
+    inithash(self, self->hashbits + 1);
+    for (size_t i = 0; i < size; ++i)
+    {
+	if (keys[i]) *posting(self, keys[i]) = postings[i];
+    }
+    free(postings);
+    free(keys);
+}
+
+static size_t slot(const EmojiSearch *self, uint64_t key)
+{
+    size_t mask = ((size_t)1 << self->hashbits) - 1;
+    size_t pos = hashpos(key, self->hashbits);
+    while (self->keys[pos] && self->keys[pos] != key) pos = (pos + 1) & mask;
+    return pos;
+}
+
+static const Posting *lookup(const EmojiSearch *self, uint64_t key)
+{
+    size_t pos = slot(self, key);
+    return self->keys[pos] ? self->postings + pos : 0;
+}
+
+static Posting *posting(EmojiSearch *self, uint64_t key)
+{
+    size_t pos = slot(self, key);
+    if (self->keys[pos]) return self->postings + pos;
+    if ((self->hashused + 1) << 1 > ((size_t)1 << self->hashbits))
+    {
+	growhash(self);
+	return posting(self, key);
+    }
+    self->keys[pos] = key;
+    self->postings[pos] = (Posting){ 0, 0, 0 };
+    ++self->hashused;
+    return self->postings + pos;
+}
+
+static void addEntry(EmojiSearch *self, char32_t *lc, const UniStr *name,
+	uint32_t emoji, int translated)
+{
+    size_t len = UniStr_len(name);
+    const char32_t *str = UniStr_str(name);
+    size_t baselen = len;
+    for (size_t i = 0; i < len; ++i)
+    {
+	if (str[i] == U':' && baselen == len) baselen = i;
+	lc[i] = UniStr_isolc(str[i]);
+    }
+    lc[len] = 0;
+
+    if (self->nentries == self->entriescapa)
+    {
+	self->entriescapa += 1024;
+	self->entries = PSC_realloc(self->entries,
+		self->entriescapa * sizeof *self->entries);
+    }
+    uint32_t id = self->nentries++;
+    self->entries[id] = (SearchEntry){
+	.lc = lc,
+	.len = len,
+	.baselen = baselen,
+	.emoji = emoji,
+	.translated = translated
+    };
+
+    for (size_t i = 0; i + 3 <= len; ++i)
+    {
+	Posting *p = posting(self, trigram(lc + i));
+	if (p->len && p->ids[p->len - 1] == id) continue;
+	if (p->len == p->capa)
+	{
+	    p->capa = p->capa ? p->capa << 1 : 4;
+	    p->ids = PSC_realloc(p->ids, p->capa * sizeof *p->ids);
+	}
+	p->ids[p->len++] = id;
+    }
+}
+
+static void indexSource(EmojiSearch *self, SearchSource *src)
+{
+    src->indexed = 1;
+    const Translator *tr = src->tr ? src->tr : self->tr;
+    /* Without a catalog, the current locale falls back to the original
+     * names, which must still be found in translated mode. Additional
+     * languages would only duplicate them. */
+    if (src->lang && !Translator_hasTranslations(tr)) return;
+
+    size_t poolsz = 0;
+    size_t nemojis = Emoji_numEmojis();
+    for (size_t i = 0; i < nemojis; ++i)
+    {
+	const Emoji *emoji = Emoji_at(i);
+	if (!Emoji_variants(emoji)) continue;
+	const UniStr *name = src->translated ? FTR(tr, Emoji_name(emoji))
+	    : NTR(tr, Emoji_name(emoji));
+	if (name) poolsz += UniStr_len(name) + 1;
+    }
+    if (!poolsz) return;
+    src->pool = PSC_malloc(poolsz * sizeof *src->pool);
+    char32_t *lc = src->pool;
+    for (size_t i = 0; i < nemojis; ++i)
+    {
+	const Emoji *emoji = Emoji_at(i);
+	if (!Emoji_variants(emoji)) continue;
+	const UniStr *name = src->translated ? FTR(tr, Emoji_name(emoji))
+	    : NTR(tr, Emoji_name(emoji));
+	if (!name) continue;
+	addEntry(self, lc, name, i, src->translated);
+	lc += UniStr_len(name) + 1;
+    }
+}
+
+void EmojiSearch_prepare(EmojiSearch *self, EmojiSearchMode mode)
+{
+    for (size_t i = 0; i < self->nsources; ++i)
+    {
+	SearchSource *src = self->sources + i;
+	if (!(mode & (src->translated ? ESM_TRANS : ESM_ORIG))) continue;
+	if ((mode & ESM_KEYWORDS) && !src->kwloaded)
+	{
+	    const char *lang = src->lang;
+	    if (!lang) lang = src->translated ? self->lang : ORIGLANG;
+	    src->keywords = EmojiKeywords_create(lang);
+	    src->kwloaded = 1;
+	}
+	if (src->indexed) continue;
+	if (src->lang && !src->tr)
+	{
+	    src->tr = Translator_create(EMOJITEXTS, src->lang, XME_get);
+	}
+	indexSource(self, src);
+    }
+}
+
+static void clearIndex(EmojiSearch *self)
+{
+    for (size_t i = 0; i < self->nsources; ++i)
+    {
+	Translator_destroy(self->sources[i].tr);
+	EmojiKeywords_destroy(self->sources[i].keywords);
+	free(self->sources[i].lang);
+	free(self->sources[i].pool);
+    }
+    free(self->sources);
+    self->sources = 0;
+    self->nsources = 0;
+    free(self->entries);
+    self->entries = 0;
+    self->nentries = 0;
+    self->entriescapa = 0;
+    size_t size = (size_t)1 << self->hashbits;
+    for (size_t i = 0; i < size; ++i)
+    {
+	if (self->keys[i]) free(self->postings[i].ids);
+    }
+    free(self->postings);
+    free(self->keys);
+}
+
+static void addSource(EmojiSearch *self, const char *lang, size_t langlen,
+	int translated)
+{
+    self->sources = PSC_realloc(self->sources,
+	    (self->nsources + 1) * sizeof *self->sources);
+    SearchSource *src = self->sources + self->nsources++;
+    src->tr = 0;
+    src->keywords = 0;
+    src->lang = 0;
+    if (lang)
+    {
+	src->lang = PSC_malloc(langlen + 1);
+	memcpy(src->lang, lang, langlen);
+	src->lang[langlen] = 0;
+    }
+    src->pool = 0;
+    src->translated = translated;
+    src->indexed = 0;
+    src->kwloaded = 0;
+}
+
+static void initIndex(EmojiSearch *self)
+{
+    inithash(self, HASHBITS);
+    addSource(self, 0, 0, 0);
+    addSource(self, 0, 0, 1);
+    const char *lang = self->languages;
+    while (lang && *lang)
+    {
+	lang += strspn(lang, LANGDELIMS);
+	size_t langlen = strcspn(lang, LANGDELIMS);
+	if (langlen) addSource(self, lang, langlen, 1);
+	lang += langlen;
+    }
+}
+
+EmojiSearch *EmojiSearch_create(const Translator *tr, const char *lang)
+{
+    EmojiSearch *self = PSC_malloc(sizeof *self);
+    memset(self, 0, sizeof *self);
+    self->tr = tr;
+    self->lang = PSC_copystr(lang);
+    initIndex(self);
+    return self;
+}
+
+void EmojiSearch_setLanguages(EmojiSearch *self, const char *languages)
+{
+    if (!languages || !*languages)
+    {
+	if (!self->languages) return;
+	languages = 0;
+    }
+    else if (self->languages && !strcmp(self->languages, languages)) return;
+    clearIndex(self);
+    free(self->languages);
+    self->languages = languages ? PSC_copystr(languages) : 0;
+    initIndex(self);
+}
+
+static int contains(const char32_t *big, size_t len,
+	const char32_t *little, size_t littlelen)
+{
+    if (littlelen > len) return 0;
+    size_t steps = len - littlelen + 1;
+    for (size_t start = 0; start < steps; ++start)
+    {
+	if (!memcmp(big + start, little, littlelen * sizeof *little))
+	{
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+static void check(unsigned char *hits, const SearchEntry *entry,
+	const char32_t *pattern, size_t patternlen, EmojiSearchMode mode)
+{
+    if (hits[entry->emoji]) return;
+    if (!(mode & (entry->translated ? ESM_TRANS : ESM_ORIG))) return;
+    if (contains(entry->lc, mode & ESM_FULL ? entry->len : entry->baselen,
+		pattern, patternlen)) hits[entry->emoji] = 1;
+}
+
+size_t EmojiSearch_match(const EmojiSearch *self, const Emoji **results,
+	size_t resultsz, size_t maxresults, const UniStr *pattern,
+	EmojiSearchMode mode, int cancelable)
+{
+    size_t patternlen = UniStr_len(pattern);
+    if (!patternlen) return 0;
+
+    char32_t *lc = PSC_malloc(patternlen * sizeof *lc);
+    const char32_t *str = UniStr_str(pattern);
+    for (size_t i = 0; i < patternlen; ++i) lc[i] = UniStr_isolc(str[i]);
+    size_t nemojis = Emoji_numEmojis();
+    unsigned char *hits = PSC_malloc(nemojis);
+    memset(hits, 0, nemojis);
+    size_t resultlen = 0;
+
+    if (patternlen >= 3)
+    {
+	const Posting *candidates = 0;
+	for (size_t i = 0; i + 3 <= patternlen; ++i)
+	{
+	    const Posting *p = lookup(self, trigram(lc + i));
+	    if (!p)
+	    {
+		candidates = 0;
+		break;
+	    }
+	    if (!candidates || p->len < candidates->len) candidates = p;
+	}
+	for (uint32_t i = 0; candidates && i < candidates->len; ++i)
+	{
+	    check(hits, self->entries + candidates->ids[i],
+		    lc, patternlen, mode);
+	}
+    }
+    else
+    {
+	for (size_t i = 0; i < self->nentries; ++i)
+	{
+	    if (cancelable && !(i & 0x3ff) && PSC_ThreadJob_canceled())
+	    {
+		goto done;
+	    }
+	    check(hits, self->entries + i, lc, patternlen, mode);
+	}
+    }
+    if (cancelable && PSC_ThreadJob_canceled()) goto done;
+    if (mode & ESM_KEYWORDS)
+    {
+	for (size_t i = 0; i < self->nsources; ++i)
+	{
+	    const SearchSource *src = self->sources + i;
+	    if (!src->keywords) continue;
+	    if (!(mode & (src->translated ? ESM_TRANS : ESM_ORIG))) continue;
+	    EmojiKeywords_match(src->keywords, lc, patternlen,
+		    hits, nemojis);
+	}
+    }
+
+    size_t nresults = 0;
+    int havebasevariant = 0;
+    for (size_t i = 0; i < nemojis; ++i)
+    {
+	const Emoji *emoji = Emoji_at(i);
+	unsigned variants = Emoji_variants(emoji);
+	int matches = 0;
+	if (havebasevariant && !variants) matches = 2;
+	else if (variants) matches = hits[i];
+	if (matches)
+	{
+	    if (matches == 1)
+	    {
+		if (++nresults > maxresults) break;
+		if (resultlen + variants > resultsz) break;
+		havebasevariant = 1;
+	    }
+	    results[resultlen++] = emoji;
+	}
+	else if (variants) havebasevariant = 0;
+    }
+
+done:
+    free(hits);
+    free(lc);
+    return resultlen;
+}
+
+void EmojiSearch_destroy(EmojiSearch *self)
+{
+    if (!self) return;
+    clearIndex(self);
+    free(self->languages);
+    free(self->lang);
+    free(self);
+}
@@ -0,0 +1,25 @@
+#ifndef XMOJI_EMOJISEARCH_H
+#define XMOJI_EMOJISEARCH_H
+
+#include "emoji.h"
+
+#include <poser/decl.h>
+#include <stddef.h>
+
+C_CLASS_DECL(EmojiSearch);
+C_CLASS_DECL(Translator);
+C_CLASS_DECL(UniStr);
+
+EmojiSearch *EmojiSearch_create(const Translator *tr, const char *lang)
+    ATTR_NONNULL((1)) ATTR_NONNULL((2)) ATTR_RETNONNULL;
+void EmojiSearch_setLanguages(EmojiSearch *self, const char *languages)
+    CMETHOD;
+void EmojiSearch_prepare(EmojiSearch *self, EmojiSearchMode mode)
+    CMETHOD;
+size_t EmojiSearch_match(const EmojiSearch *self, const Emoji **results,
+	size_t resultsz, size_t maxresults, const UniStr *pattern,
+	EmojiSearchMode mode, int cancelable)
+    CMETHOD ATTR_NONNULL((2)) ATTR_NONNULL((5));
+void EmojiSearch_destroy(EmojiSearch *self);
+
+#endif
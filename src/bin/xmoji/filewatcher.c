@@ -61,21 +61,37 @@
 #define WATCHING_EVENTS	2
 #define WATCHING_EVDIR	3
 
-typedef struct StatJobData
+#define POLLMS		1000
+#define POLLMAXTICKS	16
+
+/* Files that can't be watched with events are polled. All watchers due on
+ * a tick are checked in a single batch job, and a watcher not seeing any
+ * change doubles its interval up to POLLMAXTICKS. */
+typedef struct PollEntry
 {
-    const char *path;
+    FileWatcher *watcher;
+    char *path;
     struct timespec modified;
+    unsigned serial;
     int exists;
-} StatJobData;
+} PollEntry;
+
+typedef struct PollBatch
+{
+    size_t n;
+    PollEntry entries[];
+} PollBatch;
 
 struct FileWatcher
 {
     const char *path;
     char *dirpath;
     PSC_Event *changed;
-    PSC_ThreadJob *statJob;
-    StatJobData statJobData;
+    FileWatcher *nextPoller;
     struct timespec modified;
+    unsigned pollSerial;
+    unsigned pollInterval;
+    unsigned pollDue;
     int exists;
     int watching;
 #ifdef HAVE_EVENTS
@@ -85,8 +101,11 @@ struct FileWatcher
 #endif
 };
 
-static unsigned timerref;
+static FileWatcher *pollers;
 static PSC_Timer *timer;
+static unsigned ticks;
+static unsigned serial;
+static int polling;
 
 FileWatcher *FileWatcher_create(const char *path)
 {
@@ -102,77 +121,121 @@ FileWatcher *FileWatcher_create(const char *path)
     return self;
 }
 
-static void dostatjob(void *data)
+static void pollbatchjob(void *arg)
 {
-    StatJobData *job = data;
+    PollBatch *batch = arg;
 
-    struct stat st;
-    if (stat(job->path, &st) < 0)
+    for (size_t i = 0; i < batch->n; ++i)
     {
-	job->exists = 0;
-    }
-    else
-    {
-	job->exists = 1;
-	job->modified = st.st_mtim;
+	PollEntry *entry = batch->entries + i;
+	struct stat st;
+	if (stat(entry->path, &st) < 0)
+	{
+	    entry->exists = 0;
+	}
+	else
+	{
+	    entry->exists = 1;
+	    entry->modified = st.st_mtim;
+	}
     }
 }
 
-static void finishstat(void *receiver, void *sender, void *args)
+static void checkpolled(FileWatcher *self, const PollEntry *entry)
 {
-    (void)sender;
-    (void)args;
-
-    FileWatcher *self = receiver;
-    self->statJob = 0;
-
-    if (!self->statJobData.exists)
+    FileChange ea = FC_MODIFIED;
+    int changed = 1;
+    if (!entry->exists)
     {
-	if (!self->exists) return;
-	self->exists = 0;
-	FileChange ea = FC_DELETED;
-	PSC_Event_raise(self->changed, 0, &ea);
-	return;
+	if (self->exists)
+	{
+	    self->exists = 0;
+	    ea = FC_DELETED;
+	}
+	else changed = 0;
     }
-
-    if (!self->exists)
+    else if (!self->exists)
     {
-	self->modified = self->statJobData.modified;
+	self->modified = entry->modified;
 	self->exists = 1;
-	FileChange ea = FC_CREATED;
-	PSC_Event_raise(self->changed, 0, &ea);
-	return;
+	ea = FC_CREATED;
     }
-
-    if (memcmp(&self->modified, &self->statJobData.modified,
+    else if (memcmp(&self->modified, &entry->modified,
 		sizeof self->modified))
     {
-	self->modified = self->statJobData.modified;
-	FileChange ea = FC_MODIFIED;
-	PSC_Event_raise(self->changed, 0, &ea);
+	self->modified = entry->modified;
+    }
+    else changed = 0;
+
+    if (changed) self->pollInterval = 1;
+    else if (self->pollInterval < POLLMAXTICKS) self->pollInterval <<= 1;
+    self->pollDue = ticks + self->pollInterval;
+    if (changed) PSC_Event_raise(self->changed, 0, &ea);
+}
+
+static void finishpoll(void *receiver, void *sender, void *args)
+{
+    (void)receiver;
+    (void)sender;
+
+    PollBatch *batch = args;
+    polling = 0;
+    for (size_t i = 0; i < batch->n; ++i)
+    {
+	/* The watcher might have stopped polling or even be destroyed
+	 * meanwhile, so only compare the pointer before using it */
+	PollEntry *entry = batch->entries + i;
+	FileWatcher *watcher;
+	for (watcher = pollers; watcher && watcher != entry->watcher;
+		watcher = watcher->nextPoller);
+	if (watcher && watcher->pollSerial == entry->serial)
+	{
+	    checkpolled(watcher, entry);
+	}
+	free(entry->path);
     }
+    free(batch);
 }
 
-static void dostat(void *receiver, void *sender, void *args)
+static void dopoll(void *receiver, void *sender, void *args)
 {
+    (void)receiver;
     (void)sender;
     (void)args;
 
-    FileWatcher *self = receiver;
-    if (self->statJob) return;
-    self->statJobData.path = self->path;
+    ++ticks;
+    if (polling) return;
+    size_t n = 0;
+    for (FileWatcher *w = pollers; w; w = w->nextPoller)
+    {
+	if ((int)(ticks - w->pollDue) >= 0) ++n;
+    }
+    if (!n) return;
+
+    PollBatch *batch = PSC_malloc(sizeof *batch + n * sizeof *batch->entries);
+    batch->n = n;
+    PollEntry *entry = batch->entries;
+    for (FileWatcher *w = pollers; w; w = w->nextPoller)
+    {
+	if ((int)(ticks - w->pollDue) < 0) continue;
+	entry->watcher = w;
+	entry->path = PSC_copystr(w->path);
+	entry->serial = w->pollSerial;
+	entry->exists = 0;
+	++entry;
+    }
+    polling = 1;
 
     if (PSC_ThreadPool_active())
     {
-	self->statJob = PSC_ThreadJob_create(dostatjob, &self->statJobData, 0);
-	PSC_Event_register(PSC_ThreadJob_finished(self->statJob),
-		self, finishstat, 0);
-	PSC_ThreadPool_enqueue(self->statJob);
+	PSC_ThreadJob *job = PSC_ThreadJob_create(pollbatchjob, batch, 0);
+	PSC_Event_register(PSC_ThreadJob_finished(job), 0, finishpoll, 0);
+	PSC_ThreadPool_enqueue(job);
     }
     else
     {
-	dostatjob(&self->statJobData);
-	finishstat(self, 0, 0);
+	pollbatchjob(batch);
+	finishpoll(0, 0, batch);
     }
 }
 
@@ -511,13 +574,20 @@ int FileWatcher_watch(FileWatcher *self)
     }
     if (rc == 0)
     {
-	if (!timerref++)
+	if (!pollers)
 	{
 	    timer = PSC_Timer_create();
-	    PSC_Timer_setMs(timer, 1000);
+	    PSC_Timer_setMs(timer, POLLMS);
+	    PSC_Event_register(PSC_Timer_expired(timer), 0, dopoll, 0);
 	    PSC_Timer_start(timer, 1);
 	}
-	PSC_Event_register(PSC_Timer_expired(timer), self, dostat, 0);
+	/* (Re-)starting to watch, e.g. after writing the file ourselves,
+	 * always checks again on the next tick */
+	self->nextPoller = pollers;
+	pollers = self;
+	self->pollSerial = ++serial;
+	self->pollInterval = 1;
+	self->pollDue = ticks + 1;
 	self->watching = WATCHING_STAT;
     }
     return rc;
@@ -533,9 +603,12 @@ void FileWatcher_unwatch(FileWatcher *self)
 	return;
     }
 #endif
-    if (timer) PSC_Event_unregister(PSC_Timer_expired(timer), self, dostat, 0);
+    FileWatcher **poller;
+    for (poller = &pollers; *poller != self;
+	    poller = &(*poller)->nextPoller);
+    *poller = self->nextPoller;
     self->watching = 0;
-    if (!--timerref)
+    if (!pollers)
     {
 	PSC_Timer_destroy(timer);
 	timer = 0;
@@ -46,7 +46,7 @@ static void destroy(void *obj)
 {
     FlowGrid *self = obj;
     PSC_List_destroy(self->items);
-    free(self);
+    Object_free(self);
 }
 
 static void expose(void *obj, Rect region)
@@ -82,9 +82,10 @@ static int draw(void *obj, xcb_render_picture_t picture)
     return rc;
 }
 
-static void layout(FlowGrid *self, int updateMinSize)
+static int layout(FlowGrid *self, int updateMinSize)
 {
-    if (!self->shown) return;
+    if (!self->shown) return 0;
+    int moved = 0;
     PSC_ListIterator *i = PSC_List_iterator(self->items);
 
     if (updateMinSize)
@@ -126,8 +127,11 @@ static void layout(FlowGrid *self, int updateMinSize)
     {
 	FlowGridItem *item = PSC_ListIterator_current(i);
 	if (!Widget_isShown(item->widget)) continue;
+	Rect oldGeom = Widget_geometry(item->widget);
 	Widget_setSize(item->widget, self->itemMinSize);
 	Widget_setOrigin(item->widget, colOrigin);
+	Rect newGeom = Widget_geometry(item->widget);
+	if (memcmp(&oldGeom, &newGeom, sizeof oldGeom)) moved = 1;
 	if (!col) ++rows;
 	if (++col == cols)
 	{
@@ -152,6 +156,7 @@ static void layout(FlowGrid *self, int updateMinSize)
 
 done:
     PSC_ListIterator_destroy(i);
+    return moved;
 }
 
 static int show(void *obj)
@@ -279,13 +284,13 @@ static void sizeRequested(void *receiver, void *sender, void *args)
 
 static void shownChanged(void *receiver, void *sender, void *args)
 {
-    (void)sender;
     (void)args;
 
     FlowGrid *self = receiver;
-    layout(self, 0);
+    int moved = layout(self, 0);
     Widget_requestSize(self);
-    Widget_invalidate(self);
+    if (moved) Widget_invalidate(self);
+    else Widget_invalidateRegion(self, Widget_geometry(sender));
 }
 
 static void destroyItem(void *obj)
@@ -304,7 +309,7 @@ static void destroyItem(void *obj)
 
 FlowGrid *FlowGrid_createBase(void *derived, void *parent)
 {
-    FlowGrid *self = PSC_malloc(sizeof *self);
+    FlowGrid *self = NEWOBJ(sizeof *self);
     memset(self, 0, sizeof *self);
     CREATEBASE(Widget, 0, parent);
     self->items = PSC_List_create();
@@ -334,6 +339,33 @@ void FlowGrid_addWidget(void *self, void *widget)
     layout(g, 1);
 }
 
+void FlowGrid_swapWidgets(void *self, size_t a, size_t b)
+{
+    FlowGrid *g = Object_instance(self);
+    FlowGridItem *ia = PSC_List_at(g->items, a);
+    FlowGridItem *ib = PSC_List_at(g->items, b);
+    if (!ia || !ib || ia == ib) return;
+    PSC_Event_unregister(Widget_sizeRequested(ia->widget), ia,
+	    sizeRequested, 0);
+    PSC_Event_unregister(Widget_sizeRequested(ib->widget), ib,
+	    sizeRequested, 0);
+    void *widget = ia->widget;
+    Size minSize = ia->minSize;
+    ia->widget = ib->widget;
+    ia->minSize = ib->minSize;
+    ib->widget = widget;
+    ib->minSize = minSize;
+    PSC_Event_register(Widget_sizeRequested(ia->widget), ia,
+	    sizeRequested, 0);
+    PSC_Event_register(Widget_sizeRequested(ib->widget), ib,
+	    sizeRequested, 0);
+    if (layout(g, 0))
+    {
+	Widget_invalidate(ia->widget);
+	Widget_invalidate(ib->widget);
+    }
+}
+
 void *FlowGrid_widgetAt(void *self, size_t index)
 {
     FlowGrid *g = Object_instance(self);
@@ -39,7 +39,7 @@ static void destroy(void *obj)
     Flyout *self = obj;
     Object_destroy(self->widget);
     if (!--refcnt) Object_destroy(window);
-    free(self);
+    Object_free(self);
 }
 
 static void expose(void *obj, Rect region)
@@ -137,7 +137,7 @@ static void sizeChanged(void *receiver, void *sender, void *args)
 
 Flyout *Flyout_createBase(void *derived, const char *name, void *parent)
 {
-    Flyout *self = PSC_malloc(sizeof *self);
+    Flyout *self = NEWOBJ(sizeof *self);
     CREATEBASE(Widget, name, parent);
     self->widget = 0;
     self->incborder = 0;
@@ -1,8 +1,11 @@
+#define _POSIX_C_SOURCE 200112L
+
 #include "font.h"
 
 #ifdef WITH_SVG
 #  include "svghooks.h"
 #endif
+#include "profile.h"
 #include "x11adapter.h"
 #include "xrdb.h"
 
@@ -10,12 +13,37 @@
 #include FT_CONFIG_OPTIONS_H
 #include FT_MODULE_H
 #include FT_OUTLINE_H
+#include <hb-ft.h>
 #include <math.h>
 #include <poser/core.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
+#define MAXTHREADFACES 8
+
+typedef struct ThreadFace
+{
+    FT_Face face;
+    hb_font_t *hbfont;
+    uint32_t serial;
+} ThreadFace;
+
+/* Every thread asking for it gets its own FreeType library with its own
+ * faces and HarfBuzz fonts on first use, so background jobs can use fonts
+ * without any locking. */
+typedef struct ThreadContext
+{
+    FT_Library lib;
+    unsigned nfaces;
+    unsigned next;
+    ThreadFace faces[MAXTHREADFACES];
+} ThreadContext;
+
 static FT_Library ftlib;
+static pthread_key_t threadkey;
+static pthread_once_t threadkeyonce = PTHREAD_ONCE_INIT;
+static uint32_t nextserial;
 static int refcnt;
 static FcPattern *defaultpat;
 static PSC_HashTable *byPattern;
@@ -27,8 +55,14 @@ static FontOptions defaultOptions;
 struct Font
 {
     char *id;
+    char *file;
     FcPattern *pattern;
     FT_Face face;
+    FT_Fixed xscale;
+    FT_Fixed yscale;
+    int index;
+    int strike;
+    uint32_t serial;
     int32_t loadflags;
     FontGlyphType glyphtype;
     double pixelsize;
@@ -50,15 +84,35 @@ struct Font
 static int Font_init(void);
 static void Font_done(void);
 
+static void destroyThreadContext(void *obj)
+{
+    ThreadContext *ctx = obj;
+    for (unsigned i = 0; i < ctx->nfaces; ++i)
+    {
+	hb_font_destroy(ctx->faces[i].hbfont);
+	FT_Done_Face(ctx->faces[i].face);
+    }
+    FT_Done_FreeType(ctx->lib);
+    free(ctx);
+}
+
+static void createThreadKey(void)
+{
+    pthread_key_create(&threadkey, destroyThreadContext);
+}
+
 static int Font_init(void)
 {
     if (refcnt++) return 0;
 
+    int span = Profile_begin("Font_init", 0);
+    int fcspan = Profile_begin("FcInit", 0);
     if (FcInit() != FcTrue)
     {
 	PSC_Log_msg(PSC_L_ERROR, "Could not initialize fontconfig");
 	goto error;
     }
+    Profile_end(fcspan);
     const char *defpatstr = XRdb_value(X11Adapter_resources(),
 	    XRdbKey("Font"), 0);
     if (!defpatstr) defpatstr = "sans";
@@ -74,6 +128,7 @@ static int Font_init(void)
 	PSC_Log_msg(PSC_L_ERROR, "Could not initialize freetype");
 	goto error;
     }
+    pthread_once(&threadkeyonce, createThreadKey);
 
 #ifdef WITH_SVG
     if (FT_Property_Set(ftlib, "ot-svg", "svg-hooks", SvgHooks_get()) != 0)
@@ -101,6 +156,7 @@ static int Font_init(void)
 	defaultOptions.maxUnscaledDeviation = 5.f;
 	defaultOptions.pixelFractionBits = 3;
     }
+    Profile_end(span);
     return 0;
 
 error:
@@ -142,6 +198,7 @@ static Font *createFromFile(const char *file, int index, char *id,
 	const FontOptions *options, double pixelsize)
 {
     double fixedpixelsize = 0;
+    int strike = -1;
     FT_Face face = 0;
     if (FT_New_Face(ftlib, file, index, &face) == 0)
     {
@@ -180,6 +237,7 @@ static Font *createFromFile(const char *file, int index, char *id,
 		FT_Done_Face(face);
 		return 0;
 	    }
+	    strike = bestidx;
 	    if (bestdeviation <= maxunscaleddeviation)
 	    {
 		pixelsize = fixedpixelsize;
@@ -247,8 +305,12 @@ static Font *createFromFile(const char *file, int index, char *id,
 
     if (id) PSC_Log_fmt(PSC_L_DEBUG, "Font id: %s", id);
     self->id = id;
+    self->file = PSC_copystr(file);
     self->pattern = pattern;
     self->face = face;
+    self->index = index;
+    self->strike = strike;
+    self->serial = ++nextserial;
     self->loadflags = FT_LOAD_DEFAULT;
     FcBool bval = FcTrue;
     FcPatternGetBool(fcfont, FC_HINTING, 0, &bval);
@@ -271,6 +333,8 @@ static Font *createFromFile(const char *file, int index, char *id,
     }
     else self->glyphtype = face->face_flags & FT_FACE_FLAG_COLOR ?
 	FGT_BITMAP_BGRA : FGT_OUTLINE;
+    self->xscale = face->size->metrics.x_scale;
+    self->yscale = face->size->metrics.y_scale;
     self->pixelsize = pixelsize;
     self->fixedpixelsize = fixedpixelsize;
     self->refcnt = 1;
@@ -299,7 +363,8 @@ static Font *createFromFile(const char *file, int index, char *id,
     return self;
 }
 
-Font *Font_create(const char *pattern, const FontOptions *options)
+static Font *createFromPattern(const char *pattern,
+	const FontOptions *options)
 {
     if (Font_init() < 0) return 0;
 
@@ -434,6 +499,14 @@ Font *Font_create(const char *pattern, const FontOptions *options)
     return 0;
 }
 
+Font *Font_create(const char *pattern, const FontOptions *options)
+{
+    int span = Profile_begin("Font_create", pattern ? pattern : "<default>");
+    Font *self = createFromPattern(pattern, options);
+    Profile_end(span);
+    return self;
+}
+
 Font *Font_createVariant(Font *font, double pixelsize, FontStyle style,
 	const FontOptions *options)
 {
@@ -503,6 +576,75 @@ FT_Face Font_face(const Font *self)
     return self->face;
 }
 
+static ThreadFace *threadFace(const Font *self)
+{
+    ThreadContext *ctx = pthread_getspecific(threadkey);
+    if (!ctx)
+    {
+	ctx = PSC_malloc(sizeof *ctx);
+	memset(ctx, 0, sizeof *ctx);
+	if (FT_Init_FreeType(&ctx->lib) != 0)
+	{
+	    free(ctx);
+	    return 0;
+	}
+#ifdef WITH_SVG
+	FT_Property_Set(ctx->lib, "ot-svg", "svg-hooks", SvgHooks_get());
+#endif
+	pthread_setspecific(threadkey, ctx);
+    }
+    for (unsigned i = 0; i < ctx->nfaces; ++i)
+    {
+	if (ctx->faces[i].serial == self->serial) return ctx->faces + i;
+    }
+
+    FT_Face face;
+    if (FT_New_Face(ctx->lib, self->file, self->index, &face) != 0)
+    {
+	return 0;
+    }
+    if (self->strike >= 0)
+    {
+	if (FT_Select_Size(face, self->strike) != 0) goto error;
+	face->size->metrics.x_scale = self->xscale;
+	face->size->metrics.y_scale = self->yscale;
+    }
+    else if (FT_Set_Char_Size(face, 0,
+		(unsigned)(64.0 * self->pixelsize), 0, 0) != 0) goto error;
+
+    /* Faces of fonts destroyed in the meantime are never used again,
+     * so just replace the oldest entry when the context is full */
+    ThreadFace *tf;
+    if (ctx->nfaces < MAXTHREADFACES) tf = ctx->faces + ctx->nfaces++;
+    else
+    {
+	tf = ctx->faces + ctx->next;
+	ctx->next = (ctx->next + 1) % MAXTHREADFACES;
+	hb_font_destroy(tf->hbfont);
+	FT_Done_Face(tf->face);
+    }
+    tf->face = face;
+    tf->hbfont = hb_ft_font_create_referenced(face);
+    tf->serial = self->serial;
+    return tf;
+
+error:
+    FT_Done_Face(face);
+    return 0;
+}
+
+FT_Face Font_threadFace(const Font *self)
+{
+    ThreadFace *tf = threadFace(self);
+    return tf ? tf->face : 0;
+}
+
+hb_font_t *Font_threadHbFont(const Font *self)
+{
+    ThreadFace *tf = threadFace(self);
+    return tf ? tf->hbfont : 0;
+}
+
 FontGlyphType Font_glyphtype(const Font *self)
 {
     return self->glyphtype;
@@ -881,6 +1023,7 @@ void Font_destroy(Font *self)
     PSC_HashTableIterator_destroy(i);
     if (pat) PSC_HashTable_delete(byPattern, pat);
     if (self->pattern != defaultpat) FcPatternDestroy(self->pattern);
+    free(self->file);
     free(self->id);
     free(self);
     Font_done();
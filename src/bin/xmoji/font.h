@@ -3,6 +3,7 @@
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include <hb.h>
 #include <poser/decl.h>
 #include <stdint.h>
 #include <xcb/render.h>
@@ -44,6 +45,11 @@ Font *Font_createVariant(Font *font, double pixelsize, FontStyle style,
 	const FontOptions *options);
 Font *Font_ref(Font *font);
 FT_Face Font_face(const Font *self) CMETHOD ATTR_RETNONNULL;
+/* Groundwork for loading glyphs or shaping in thread jobs, nothing uses
+ * these yet. They return a face and HarfBuzz font private to the calling
+ * thread, or NULL if it can't be opened. */
+FT_Face Font_threadFace(const Font *self) CMETHOD;
+hb_font_t *Font_threadHbFont(const Font *self) CMETHOD;
 FontGlyphType Font_glyphtype(const Font *self) CMETHOD;
 double Font_pixelsize(const Font *self) CMETHOD;
 double Font_fixedpixelsize(const Font *self) CMETHOD;
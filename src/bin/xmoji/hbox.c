@@ -39,7 +39,7 @@ static void destroy(void *obj)
 {
     HBox *self = obj;
     PSC_List_destroy(self->items);
-    free(self);
+    Object_free(self);
 }
 
 static void destroyItem(void *obj)
@@ -277,7 +277,7 @@ static void sizeRequested(void *receiver, void *sender, void *args)
 
 HBox *HBox_createBase(void *derived, void *parent)
 {
-    HBox *self = PSC_malloc(sizeof *self);
+    HBox *self = NEWOBJ(sizeof *self);
     CREATEBASE(Widget, 0, parent);
     self->items = PSC_List_create();
     self->minSize = (Size){0, 0};
@@ -26,7 +26,7 @@ static void destroy(void *obj)
 {
     HyperLink *self = obj;
     free(self->link);
-    free(self);
+    Object_free(self);
 }
 
 static void enter(void *obj)
@@ -50,7 +50,7 @@ static int clicked(void *obj, const ClickEvent *event)
 
 HyperLink *HyperLink_createBase(void *derived, const char *name, void *parent)
 {
-    HyperLink *self = PSC_malloc(sizeof *self);
+    HyperLink *self = NEWOBJ(sizeof *self);
     CREATEBASE(TextLabel, name, parent);
     self->link = 0;
     TextLabel_setColor(self, COLOR_LINK);
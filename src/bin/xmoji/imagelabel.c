@@ -24,7 +24,7 @@ static void destroy(void *obj)
 {
     ImageLabel *self = obj;
     Pixmap_destroy(self->pixmap);
-    free(self);
+    Object_free(self);
 }
 
 static int draw(void *obj, xcb_render_picture_t picture)
@@ -44,7 +44,7 @@ static Size minSize(const void *obj)
 
 ImageLabel *ImageLabel_createBase(void *derived, const char *name, void *parent)
 {
-    ImageLabel *self = PSC_malloc(sizeof *self);
+    ImageLabel *self = NEWOBJ(sizeof *self);
     CREATEBASE(Widget, name, parent);
     self->pixmap = 0;
     self->minSize = (Size){0, 0};
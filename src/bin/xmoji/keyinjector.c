@@ -1,43 +1,115 @@
 #include "keyinjector.h"
 
 #include "unistr.h"
+#include "widget.h"
+#include "window.h"
 #include "x11adapter.h"
 
 #include <poser/core.h>
 #include <stdlib.h>
 #include <string.h>
+#include <xcb/xkb.h>
 #include <xcb/xtest.h>
+#include <xkbcommon/xkbcommon.h>
 
 #define MAXQUEUELEN 64
-
-typedef struct InjectJob
-{
-    UniStr *str;
-    xcb_keysym_t *orig;
-    unsigned len;
-    unsigned symspercode;
-} InjectJob;
+#define KEYSCHUNK 64
+#define MAXPASTEKEYS 8
+#define MAXCLASSDEPTH 8
+#define DEFPASTEKEYS "Control_L+v"
 
 static PSC_Timer *before;
 static PSC_Timer *after;
 static InjectorFlags injectflags;
 
-static InjectJob queue[MAXQUEUELEN];
+static UniStr *queue[MAXQUEUELEN];
 static unsigned queuelen;
 static unsigned queuefront;
 static unsigned queueback;
 
+#define MAXOWNCHANGES 4
+
+/* Own keymap changes not notified yet, a MapNotify for exactly the keycode
+ * range of the oldest one is caused by it */
+typedef struct OwnChange
+{
+    unsigned sequence;
+    uint8_t first;
+    uint8_t num;
+} OwnChange;
+
+/* Original keysyms of the whole keycode range, kept between bursts until
+ * somebody else changes the keymap */
+static xcb_keysym_t *orig;
+static unsigned origcodes;
+static unsigned symspercode;
+static OwnChange ownchanges[MAXOWNCHANGES];
+static unsigned nownchanges;
+static int origstale;
+
+/* Longest run of keycodes without any keysyms, preferred for remapping */
+static unsigned blockstart;
+static unsigned blocklen;
+
+/* Current burst: distinct codepoints with the keycodes producing them,
+ * the remapped range and the sequence of keycodes to fake */
+static char32_t *cps;
+static uint8_t *keycodes;
+static unsigned ncps;
+static unsigned remapbase;
+static unsigned nmapped;
+static uint8_t *keys;
+static size_t nkeys;
+static size_t keyscapa;
+static unsigned burstlen;
+
+/* Paste mode: the widget owning our selections, the paste keys per
+ * WM_CLASS, the text currently pasted and the selection contents to
+ * restore afterwards */
+static Widget *pasteowner;
+static char *pastekeys;
+static UniStr *pastetext;
+static UniStr *saved[XSN_CLIPBOARD + 1];
+static xcb_window_t classwin;
+static unsigned classdepth;
+static xcb_keycode_t pastecodes[MAXPASTEKEYS];
+static unsigned npastecodes;
+
 static void finish(void);
 static void resetkmap(void *receiver, void *sender, void *args);
 static void fakekeys(void *receiver, void *sender, void *args);
+static void keymapchanged(void *receiver, void *sender, void *args);
+static void changekmap(uint8_t first, uint8_t num,
+	const xcb_keysym_t *syms);
+static size_t jobcodepoints(const UniStr *str, char32_t *seq);
+static int addjob(const UniStr *str, int truncate);
+static uint8_t findkey(char32_t codepoint);
+static void fakepaste(void);
+static void restoreselections(void);
+static xcb_keycode_t findkeysym(xcb_keysym_t keysym);
+static int matchclass(const char *name, size_t namelen,
+	const char *instance, const char *cls);
+static void choosepastekeys(const char *instance, const char *cls);
+static void pasteparent(void *obj, unsigned sequence,
+	void *reply, xcb_generic_error_t *error);
+static void pasteclass(void *obj, unsigned sequence,
+	void *reply, xcb_generic_error_t *error);
+static void findclass(xcb_window_t w);
+static void pastefocus(void *obj, unsigned sequence,
+	void *reply, xcb_generic_error_t *error);
+static void saveprimary(Widget *widget, XSelectionContent content);
+static void saveclipboard(Widget *widget, XSelectionContent content);
+static void pasteburst(void);
+static void mapburst(void);
 static void doinject(void *obj, unsigned sequence,
 	void *reply, xcb_generic_error_t *error);
 static void injectnext(void);
 
 static void finish(void)
 {
-    if (++queuefront == MAXQUEUELEN) queuefront = 0;
-    --queuelen;
+    queuefront = (queuefront + burstlen) % MAXQUEUELEN;
+    queuelen -= burstlen;
+    burstlen = 0;
     injectnext();
 }
 
@@ -47,13 +119,15 @@ static void resetkmap(void *receiver, void *sender, void *args)
     (void)sender;
     (void)args;
 
-    xcb_connection_t *c = X11Adapter_connection();
-    const xcb_setup_t *setup = xcb_get_setup(c);
-    CHECK(xcb_change_keyboard_mapping(c, queue[queuefront].len,
-		setup->min_keycode, queue[queuefront].symspercode,
-		queue[queuefront].orig),
-	    "KeyInjector: Cannot change keymap", 0);
-    free(queue[queuefront].orig);
+    if (pastetext)
+    {
+	restoreselections();
+	finish();
+	return;
+    }
+    const xcb_setup_t *setup = xcb_get_setup(X11Adapter_connection());
+    changekmap(setup->min_keycode + remapbase, nmapped,
+	    orig + remapbase * symspercode);
     finish();
 }
 
@@ -63,36 +137,81 @@ static void fakekeys(void *receiver, void *sender, void *args)
     (void)sender;
     (void)args;
 
+    if (pastetext)
+    {
+	fakepaste();
+	return;
+    }
     xcb_connection_t *c = X11Adapter_connection();
-    const xcb_setup_t *setup = xcb_get_setup(c);
-    for (unsigned x = 0; x < queue[queuefront].len; ++x)
+    for (size_t x = 0; x < nkeys; ++x)
     {
-	CHECK(xcb_test_fake_input(c, XCB_KEY_PRESS, setup->min_keycode + x,
+	CHECK(xcb_test_fake_input(c, XCB_KEY_PRESS, keys[x],
 		    XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0),
 		"KeyInjector: Cannot inject fake key press event", 0);
-	CHECK(xcb_test_fake_input(c, XCB_KEY_RELEASE, setup->min_keycode + x,
+	CHECK(xcb_test_fake_input(c, XCB_KEY_RELEASE, keys[x],
 		    XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0),
 		"KeyInjector: Cannot inject fake key release event", 0);
     }
 
-    PSC_Timer_start(after, 0);
+    if (nmapped) PSC_Timer_start(after, 0);
+    else finish();
 }
 
-static void doinject(void *obj, unsigned sequence,
+static void dropownchange(unsigned i)
+{
+    memmove(ownchanges + i, ownchanges + i + 1,
+	    (--nownchanges - i) * sizeof *ownchanges);
+}
+
+static void kmapchangefailed(void *ctx, unsigned sequence,
 	void *reply, xcb_generic_error_t *error)
 {
-    (void)obj;
-    (void)sequence;
+    (void)ctx;
+    (void)reply;
 
-    if (!reply || error)
+    if (!error) return;
+    PSC_Log_msg(PSC_L_ERROR, "KeyInjector: Cannot change keymap");
+
+    /* No MapNotify will arrive for this change */
+    for (unsigned i = 0; i < nownchanges; ++i)
     {
-	finish();
-	return;
+	if (ownchanges[i].sequence == sequence)
+	{
+	    dropownchange(i);
+	    break;
+	}
     }
+}
 
-    xcb_get_keyboard_mapping_reply_t *kmap = reply;
-    size_t len = UniStr_len(queue[queuefront].str);
-    const char32_t *codepoints = UniStr_str(queue[queuefront].str);
+static void changekmap(uint8_t first, uint8_t num, const xcb_keysym_t *syms)
+{
+    unsigned sequence = CHECK(xcb_change_keyboard_mapping(
+		X11Adapter_connection(), num, first, symspercode, syms),
+	    0, kmapchangefailed);
+
+    /* Can't tell this one apart, so just fetch the keymap again */
+    if (nownchanges == MAXOWNCHANGES) origstale = 1;
+    else ownchanges[nownchanges++] = (OwnChange){ sequence, first, num };
+}
+
+static void keymapchanged(void *receiver, void *sender, void *args)
+{
+    (void)receiver;
+    (void)sender;
+
+    const xcb_xkb_map_notify_event_t *ev = args;
+    if (ev && nownchanges && ev->firstKeySym == ownchanges[0].first
+	    && ev->nKeySyms == ownchanges[0].num)
+    {
+	dropownchange(0);
+    }
+    else origstale = 1;
+}
+
+static size_t jobcodepoints(const UniStr *str, char32_t *seq)
+{
+    size_t len = UniStr_len(str);
+    const char32_t *codepoints = UniStr_str(str);
     int zwj = 0;
     unsigned prelen = 0;
     unsigned postlen = 0;
@@ -119,44 +238,443 @@ static void doinject(void *obj, unsigned sequence,
 	if (!zwj) ++len;
     }
 
-    queue[queuefront].orig = PSC_malloc(len
-	    * kmap->keysyms_per_keycode * sizeof *queue[queuefront].orig);
-    memcpy(queue[queuefront].orig, xcb_get_keyboard_mapping_keysyms(kmap),
-	    len * kmap->keysyms_per_keycode * sizeof *queue[queuefront].orig);
-    xcb_keysym_t *syms = PSC_malloc(len
-	    * kmap->keysyms_per_keycode * sizeof *syms);
-    unsigned z = 0;
     static const char32_t zw[] = { 0x200b, 0x200d };
     for (unsigned x = 0; x < len; ++x)
     {
-	char32_t codepoint;
-	if (x < prelen) codepoint = *(zw + x + (2 - prelen));
-	else if (x < len - postlen) codepoint = codepoints[x-prelen];
-	else codepoint = (injectflags & IF_ADDSPACE) ? 0x20 : *zw;
-	for (size_t y = 0; y < kmap->keysyms_per_keycode; ++y)
+	if (x < prelen) seq[x] = *(zw + x + (2 - prelen));
+	else if (x < len - postlen) seq[x] = codepoints[x-prelen];
+	else seq[x] = (injectflags & IF_ADDSPACE) ? 0x20 : *zw;
+    }
+    return len;
+}
+
+static int addjob(const UniStr *str, int truncate)
+{
+    char32_t *seq = PSC_malloc((UniStr_len(str) + 2) * sizeof *seq);
+    size_t len = jobcodepoints(str, seq);
+    unsigned oldcps = ncps;
+    size_t oldkeys = nkeys;
+    int ok = 1;
+    for (size_t x = 0; x < len; ++x)
+    {
+	unsigned key;
+	for (key = 0; key < ncps && cps[key] != seq[x]; ++key);
+	if (key == ncps)
+	{
+	    if (ncps == origcodes)
+	    {
+		if (truncate) break;
+		ncps = oldcps;
+		nkeys = oldkeys;
+		ok = 0;
+		break;
+	    }
+	    cps[ncps++] = seq[x];
+	}
+	if (nkeys == keyscapa)
+	{
+	    keyscapa += KEYSCHUNK;
+	    keys = PSC_realloc(keys, keyscapa * sizeof *keys);
+	}
+	keys[nkeys++] = key;
+    }
+    free(seq);
+    return ok;
+}
+
+static uint8_t findkey(char32_t codepoint)
+{
+    /* Only trust the tracked keymap when it isn't waiting for one of our
+     * own changes to arrive */
+    if (nownchanges) return 0;
+    const xcb_setup_t *setup = xcb_get_setup(X11Adapter_connection());
+    for (unsigned x = origcodes; x-- > 0;)
+    {
+	const xcb_keysym_t *syms = orig + x * symspercode;
+	unsigned y;
+	for (y = 0; y < symspercode && !syms[y]; ++y);
+	if (y == symspercode) continue;
+	if (X11Adapter_keyCodepoint(setup->min_keycode + x) == codepoint)
+	{
+	    return setup->min_keycode + x;
+	}
+    }
+    return 0;
+}
+
+static void fakepaste(void)
+{
+    xcb_connection_t *c = X11Adapter_connection();
+    for (unsigned x = 0; x < npastecodes; ++x)
+    {
+	CHECK(xcb_test_fake_input(c, XCB_KEY_PRESS, pastecodes[x],
+		    XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0),
+		"KeyInjector: Cannot inject fake key press event", 0);
+    }
+    for (unsigned x = npastecodes; x-- > 0;)
+    {
+	CHECK(xcb_test_fake_input(c, XCB_KEY_RELEASE, pastecodes[x],
+		    XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0),
+		"KeyInjector: Cannot inject fake key release event", 0);
+    }
+    PSC_Timer_start(after, 0);
+}
+
+static void restoreselections(void)
+{
+    for (int x = XSN_PRIMARY; x <= XSN_CLIPBOARD; ++x)
+    {
+	/* Without any text to restore, don't leave the emoji behind */
+	if (!saved[x])
+	{
+	    Widget_releaseSelection(pasteowner, x);
+	    continue;
+	}
+	Widget_setSelection(pasteowner, x,
+		(XSelectionContent){saved[x], XST_TEXT});
+	UniStr_destroy(saved[x]);
+	saved[x] = 0;
+    }
+    UniStr_destroy(pastetext);
+    pastetext = 0;
+}
+
+static xcb_keycode_t findkeysym(xcb_keysym_t keysym)
+{
+    const xcb_setup_t *setup = xcb_get_setup(X11Adapter_connection());
+    for (unsigned y = 0; y < symspercode; ++y)
+    {
+	for (unsigned x = 0; x < origcodes; ++x)
+	{
+	    if (orig[x * symspercode + y] == keysym)
+	    {
+		return setup->min_keycode + x;
+	    }
+	}
+    }
+    return 0;
+}
+
+static int matchclass(const char *name, size_t namelen,
+	const char *instance, const char *cls)
+{
+    if (namelen == 1 && *name == '*') return 1;
+    if (instance && strlen(instance) == namelen
+	    && !strncmp(name, instance, namelen)) return 1;
+    if (cls && strlen(cls) == namelen
+	    && !strncmp(name, cls, namelen)) return 1;
+    return 0;
+}
+
+/* pastekeys is a list of entries separated by semicolons, each entry in the
+ * form "CLASS=KEY+KEY...", with keys given as keysym names. The first entry
+ * matching the instance or class name of the focused window is used, a
+ * CLASS of "*" matches every window. */
+static void choosepastekeys(const char *instance, const char *cls)
+{
+    const char *keyspec = DEFPASTEKEYS;
+    size_t speclen = sizeof DEFPASTEKEYS - 1;
+    const char *entry = pastekeys;
+    while (entry && *entry)
+    {
+	size_t entrylen = strcspn(entry, ";");
+	const char *eq = memchr(entry, '=', entrylen);
+	if (eq && matchclass(entry, eq - entry, instance, cls))
+	{
+	    keyspec = eq + 1;
+	    speclen = entrylen - (eq + 1 - entry);
+	    break;
+	}
+	entry += entrylen;
+	if (*entry) ++entry;
+    }
+
+    npastecodes = 0;
+    while (speclen)
+    {
+	size_t keylen = 0;
+	while (keylen < speclen && keyspec[keylen] != '+') ++keylen;
+	char name[64];
+	if (keylen >= sizeof name || npastecodes == MAXPASTEKEYS)
+	{
+	    goto invalid;
+	}
+	memcpy(name, keyspec, keylen);
+	name[keylen] = 0;
+	xkb_keysym_t keysym = xkb_keysym_from_name(name,
+		XKB_KEYSYM_NO_FLAGS);
+	if (keysym == XKB_KEY_NoSymbol
+		|| !(pastecodes[npastecodes++] = findkeysym(keysym)))
+	{
+	    PSC_Log_fmt(PSC_L_WARNING, "KeyInjector: No key found for "
+		    "`%s', cannot paste", name);
+	    goto invalid;
+	}
+	keyspec += keylen;
+	speclen -= keylen;
+	if (speclen)
 	{
-	    syms[z++] = codepoint > 0xff ? 0x1000000U + codepoint : codepoint;
+	    ++keyspec;
+	    --speclen;
 	}
     }
+    if (npastecodes)
+    {
+	if (before) PSC_Timer_start(before, 0);
+	else fakepaste();
+	return;
+    }
+
+invalid:
+    restoreselections();
+    finish();
+}
+
+static void pasteparent(void *obj, unsigned sequence,
+	void *reply, xcb_generic_error_t *error)
+{
+    (void)obj;
+    (void)sequence;
+
+    xcb_query_tree_reply_t *tree = reply;
+    if (!tree || error || !tree->parent || tree->parent == tree->root)
+    {
+	choosepastekeys(0, 0);
+	return;
+    }
+    findclass(tree->parent);
+}
+
+static void pasteclass(void *obj, unsigned sequence,
+	void *reply, xcb_generic_error_t *error)
+{
+    (void)obj;
+    (void)sequence;
+
+    xcb_get_property_reply_t *prop = reply;
+    int len = prop && !error ? xcb_get_property_value_length(prop) : 0;
+    if (len > 0)
+    {
+	/* WM_CLASS holds two NUL-terminated strings, instance and class */
+	char *wmclass = PSC_malloc(len + 2);
+	memcpy(wmclass, xcb_get_property_value(prop), len);
+	wmclass[len] = 0;
+	wmclass[len + 1] = 0;
+	choosepastekeys(wmclass, wmclass + strlen(wmclass) + 1);
+	free(wmclass);
+	return;
+    }
+    if (classdepth == MAXCLASSDEPTH)
+    {
+	choosepastekeys(0, 0);
+	return;
+    }
+    AWAIT(xcb_query_tree(X11Adapter_connection(), classwin),
+	    0, pasteparent);
+}
+
+static void findclass(xcb_window_t w)
+{
+    classwin = w;
+    ++classdepth;
+    AWAIT(xcb_get_property(X11Adapter_connection(), 0, w, A(WM_CLASS),
+		XCB_ATOM_STRING, 0, 64), 0, pasteclass);
+}
+
+static void pastefocus(void *obj, unsigned sequence,
+	void *reply, xcb_generic_error_t *error)
+{
+    (void)obj;
+    (void)sequence;
+
+    xcb_get_input_focus_reply_t *focus = reply;
+    classdepth = 0;
+    if (!focus || error || focus->focus == XCB_NONE
+	    || focus->focus == XCB_INPUT_FOCUS_POINTER_ROOT)
+    {
+	choosepastekeys(0, 0);
+	return;
+    }
+    findclass(focus->focus);
+}
+
+static void saveprimary(Widget *widget, XSelectionContent content)
+{
+    (void)widget;
+
+    if (content.type == XST_TEXT)
+    {
+	saved[XSN_PRIMARY] = UniStr_ref(content.data);
+    }
+
+    /* The selections are acquired before the input focus is queried, so
+     * we own them by the time the paste key is faked */
+    XSelectionContent text = { pastetext, XST_TEXT };
+    Widget_setSelection(pasteowner, XSN_CLIPBOARD, text);
+    Widget_setSelection(pasteowner, XSN_PRIMARY, text);
+    AWAIT(xcb_get_input_focus(X11Adapter_connection()), 0, pastefocus);
+}
+
+static void saveclipboard(Widget *widget, XSelectionContent content)
+{
+    if (content.type == XST_TEXT)
+    {
+	saved[XSN_CLIPBOARD] = UniStr_ref(content.data);
+    }
+    XSelection_request(Window_primary(Window_fromWidget(widget)),
+	    XST_TEXT, widget, saveprimary);
+}
+
+static void pasteburst(void)
+{
+    burstlen = 1;
+    const UniStr *str = queue[queuefront];
+    char32_t *seq = PSC_malloc((UniStr_len(str) + 3) * sizeof *seq);
+    seq[jobcodepoints(str, seq)] = 0;
+    pastetext = UniStr_createOwned(seq);
+    UniStr_destroy(queue[queuefront]);
+    queue[queuefront] = 0;
+    XSelection_request(Window_clipboard(Window_fromWidget(pasteowner)),
+	    XST_TEXT, pasteowner, saveclipboard);
+}
+
+static void mapburst(void)
+{
+    if ((injectflags & IF_PASTE) && pasteowner)
+    {
+	pasteburst();
+	return;
+    }
+    ncps = 0;
+    nkeys = 0;
+    burstlen = 0;
+    while (burstlen < queuelen)
+    {
+	unsigned pos = (queuefront + burstlen) % MAXQUEUELEN;
+	if (!addjob(queue[pos], !burstlen)) break;
+	UniStr_destroy(queue[pos]);
+	queue[pos] = 0;
+	++burstlen;
+    }
+    if (!nkeys)
+    {
+	finish();
+	return;
+    }
 
+    /* Codepoints already available in the current keymap are typed with
+     * their existing keys, the rest goes to a contiguous range of keycodes,
+     * preferably one that is unused anyway. Reused keys must not be part
+     * of that range. */
     xcb_connection_t *c = X11Adapter_connection();
     const xcb_setup_t *setup = xcb_get_setup(c);
-    CHECK(xcb_change_keyboard_mapping(c, len, setup->min_keycode,
-		kmap->keysyms_per_keycode, syms),
-	    "KeyInjector: Cannot change keymap", 0);
+    for (unsigned x = 0; x < ncps; ++x) keycodes[x] = findkey(cps[x]);
+    int conflict;
+    do
+    {
+	nmapped = 0;
+	for (unsigned x = 0; x < ncps; ++x) if (!keycodes[x]) ++nmapped;
+	remapbase = nmapped <= blocklen ? blockstart : 0;
+	conflict = 0;
+	for (unsigned x = 0; x < ncps; ++x)
+	{
+	    unsigned offset = keycodes[x] - setup->min_keycode;
+	    if (keycodes[x] && offset >= remapbase
+		    && offset < remapbase + nmapped)
+	    {
+		keycodes[x] = 0;
+		conflict = 1;
+	    }
+	}
+    } while (conflict);
+
+    xcb_keysym_t *syms = 0;
+    if (nmapped) syms = PSC_malloc(nmapped * symspercode * sizeof *syms);
+    unsigned n = 0;
+    unsigned z = 0;
+    for (unsigned x = 0; x < ncps; ++x)
+    {
+	if (keycodes[x]) continue;
+	keycodes[x] = setup->min_keycode + remapbase + n++;
+	for (unsigned y = 0; y < symspercode; ++y)
+	{
+	    syms[z++] = cps[x] > 0xff ? 0x1000000U + cps[x] : cps[x];
+	}
+    }
+    for (size_t x = 0; x < nkeys; ++x) keys[x] = keycodes[keys[x]];
+
+    if (!nmapped)
+    {
+	fakekeys(0, 0, 0);
+	return;
+    }
+
+    changekmap(setup->min_keycode + remapbase, nmapped, syms);
     free(syms);
-    UniStr_destroy(queue[queuefront].str);
-    queue[queuefront].len = len;
-    queue[queuefront].symspercode = kmap->keysyms_per_keycode;
 
     if (before) PSC_Timer_start(before, 0);
     else fakekeys(0, 0, 0);
 }
 
+static void doinject(void *obj, unsigned sequence,
+	void *reply, xcb_generic_error_t *error)
+{
+    (void)obj;
+    (void)sequence;
+
+    if (!reply || error || !((xcb_get_keyboard_mapping_reply_t *)
+		reply)->keysyms_per_keycode)
+    {
+	UniStr_destroy(queue[queuefront]);
+	queue[queuefront] = 0;
+	burstlen = 1;
+	finish();
+	return;
+    }
+
+    xcb_get_keyboard_mapping_reply_t *kmap = reply;
+    symspercode = kmap->keysyms_per_keycode;
+    origcodes = kmap->length / symspercode;
+    orig = PSC_malloc(origcodes * symspercode * sizeof *orig);
+    memcpy(orig, xcb_get_keyboard_mapping_keysyms(kmap),
+	    origcodes * symspercode * sizeof *orig);
+    cps = PSC_realloc(cps, origcodes * sizeof *cps);
+    keycodes = PSC_realloc(keycodes, origcodes * sizeof *keycodes);
+
+    blockstart = 0;
+    blocklen = 0;
+    unsigned runstart = 0;
+    for (unsigned x = 0; x < origcodes; ++x)
+    {
+	const xcb_keysym_t *syms = orig + x * symspercode;
+	unsigned y;
+	for (y = 0; y < symspercode && !syms[y]; ++y);
+	if (y < symspercode) runstart = x + 1;
+	else if (x + 1 - runstart > blocklen)
+	{
+	    blockstart = runstart;
+	    blocklen = x + 1 - runstart;
+	}
+    }
+    mapburst();
+}
+
 static void injectnext(void)
 {
     if (!queuelen) return;
 
+    if (orig && origstale)
+    {
+	free(orig);
+	orig = 0;
+    }
+    origstale = 0;
+    if (orig)
+    {
+	mapburst();
+	return;
+    }
+
     xcb_connection_t *c = X11Adapter_connection();
     const xcb_setup_t *setup = xcb_get_setup(c);
     AWAIT(xcb_get_keyboard_mapping(c, setup->min_keycode,
@@ -184,15 +702,23 @@ void KeyInjector_init(unsigned beforems, unsigned afterms, InjectorFlags flags)
     {
 	after = PSC_Timer_create();
 	PSC_Event_register(PSC_Timer_expired(after), 0, resetkmap, 0);
+	PSC_Event_register(X11Adapter_keymapChanged(), 0, keymapchanged, 0);
     }
     PSC_Timer_setMs(after, afterms);
     injectflags = flags;
 }
 
+void KeyInjector_initPaste(void *owner, const char *keys)
+{
+    pasteowner = owner;
+    free(pastekeys);
+    pastekeys = keys ? PSC_copystr(keys) : 0;
+}
+
 void KeyInjector_inject(const UniStr *str)
 {
     if (queuelen == MAXQUEUELEN) return;
-    queue[queueback].str = UniStr_ref(str);
+    queue[queueback] = UniStr_ref(str);
     if (++queueback == MAXQUEUELEN) queueback = 0;
     if (!queuelen++) injectnext();
 }
@@ -200,9 +726,21 @@ void KeyInjector_inject(const UniStr *str)
 void KeyInjector_done(void)
 {
     if (!after) return;
+    PSC_Event_unregister(X11Adapter_keymapChanged(), 0, keymapchanged, 0);
     PSC_Timer_destroy(after);
     after = 0;
     PSC_Timer_destroy(before);
     before = 0;
+    free(orig);
+    orig = 0;
+    free(cps);
+    cps = 0;
+    free(keycodes);
+    keycodes = 0;
+    free(keys);
+    keys = 0;
+    keyscapa = 0;
+    free(pastekeys);
+    pastekeys = 0;
+    pasteowner = 0;
 }
-
@@ -10,12 +10,15 @@ typedef enum InjectorFlags
     IF_NONE	    = 0,
     IF_ADDSPACE	    = 1 << 0, /* Inject a space after each emoji */
     IF_ADDZWSPACE   = 1 << 1, /* Inject a zero-width space after each emoji */
-    IF_EXTRAZWJ	    = 1 << 2  /* For a ZWJ sequence, add an extra ZWJ at the
+    IF_EXTRAZWJ	    = 1 << 2, /* For a ZWJ sequence, add an extra ZWJ at the
 				 beginning */
+    IF_PASTE	    = 1 << 3  /* Publish the emoji as selection and fake a
+				 paste key instead of remapping keys */
 } InjectorFlags;
 
 void KeyInjector_init(unsigned beforems, unsigned afterms,
 	InjectorFlags flags);
+void KeyInjector_initPaste(void *owner, const char *pastekeys);
 void KeyInjector_inject(const UniStr *str);
 void KeyInjector_done(void);
 
@@ -53,7 +53,7 @@ static void destroy(void *obj)
 {
     Menu *self = obj;
     PSC_List_destroy(self->items);
-    free(self);
+    Object_free(self);
 }
 
 static void expose(void *obj, Rect region)
@@ -177,7 +177,7 @@ static int clicked(void *obj, const ClickEvent *event)
 
 Menu *Menu_createBase(void *derived, const char *name, void *parent)
 {
-    Menu *self = PSC_malloc(sizeof *self);
+    Menu *self = NEWOBJ(sizeof *self);
     CREATEBASE(Widget, name, parent);
     self->window = 0;
     self->items = PSC_List_create();
@@ -1,12 +1,51 @@
 #include "object.h"
 
 #include <poser/core.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define TYPESCHUNK 64
+#define MAXLEVELS 8
+#define MAXLAYOUTS 2
+#define SLABBLOCKS 32
 
-static MetaObject mo = MetaObject_init("Object", free);
-static MetaObject **types;
+#define OBJALIGN (_Alignof(max_align_t))
+#define ALIGNED(s) (((s) + OBJALIGN - 1) & ~(OBJALIGN - 1))
+
+typedef void (*MetaMethod)(void);
+
+/* Blocks holding all levels of one object, for a most-derived type with a
+ * given size of its own level. The total size is learned from the first
+ * object constructed, later ones are carved from chunks of SLABBLOCKS
+ * blocks, released blocks are kept on a free list for reuse. */
+typedef struct ObjectSlab
+{
+    size_t dsize;
+    size_t total;
+    void *freeBlocks;
+    void *chunks;
+    unsigned used;
+    size_t reserved;
+} ObjectSlab;
+
+typedef struct MetaType
+{
+    MetaObject *meta;
+    void *resolved;
+    size_t size;
+    unsigned depth;
+    ObjectSlab *slabs[MAXLAYOUTS];
+    unsigned long created;
+    unsigned long live;
+    unsigned long peak;
+    size_t bytes;
+} MetaType;
+
+static void destroyBase(void *obj);
+
+static MetaObject mo = MetaObject_init("Object", destroyBase);
+static MetaType *types;
 static uint32_t typesnum;
 static uint32_t typescapa;
 static size_t objects;
@@ -16,10 +55,26 @@ typedef struct ObjectBase
     Object base;
     void *mostDerived;
     PSC_List *owned;
+    void *block;
+    ObjectSlab *slab;
+    size_t size;
+    Object *levels[MAXLEVELS];
+    unsigned nlevels;
     int refcnt;
 } ObjectBase;
 
-uint32_t MetaObject_register(void *meta)
+/* The object currently under construction, allocation of its levels is
+ * strictly nested, starting with the most-derived one */
+static struct
+{
+    void *owner;
+    ObjectSlab *slab;
+    char *next;
+    char *end;
+    size_t size;
+} building;
+
+uint32_t MetaObject_register(void *meta, size_t size)
 {
     MetaObject *m = meta;
     if (m->id && m->id < typesnum) goto done;
@@ -27,7 +82,7 @@ uint32_t MetaObject_register(void *meta)
     {
 	typescapa = TYPESCHUNK;
 	types = PSC_malloc(typescapa * sizeof *types);
-	types[typesnum++] = &mo;
+	types[typesnum++] = (MetaType){ .meta = &mo, .size = sizeof mo };
     }
     else if (typesnum == typescapa)
     {
@@ -35,7 +90,7 @@ uint32_t MetaObject_register(void *meta)
 	types = PSC_realloc(types, typescapa * sizeof *types);
     }
     m->id = typesnum;
-    types[typesnum++] = m;
+    types[typesnum++] = (MetaType){ .meta = m, .size = size };
 done:
     return m->id;
 }
@@ -43,21 +98,226 @@ done:
 const void *MetaObject_get(uint32_t id)
 {
     if (id >= typesnum) return 0;
-    return types[id];
+    return types[id].meta;
+}
+
+const void *MetaObject_resolved(const void *obj)
+{
+    const Object *o = obj;
+    if (!o) return 0;
+    MetaType *t = types + o->type;
+    if (t->resolved) return t->resolved;
+
+    /* Only possible once the object is fully constructed down to the root,
+     * callers fall back to walking the chain otherwise */
+    const Object *b = o;
+    while (b->base) b = b->base;
+    if (b->type) return 0;
+
+    /* Flatten the method table: Every method slot left empty is taken from
+     * the nearest base class providing it. Slots of a class are only
+     * present in the meta objects of this class and its derived classes,
+     * so this resolves exactly like walking the chain on each call. */
+    char *table = PSC_malloc(t->size);
+    memcpy(table, t->meta, t->size);
+    for (b = o->base; b; b = b->base)
+    {
+	const MetaType *bt = types + b->type;
+	for (size_t pos = sizeof mo; pos + sizeof (MetaMethod) <= bt->size;
+		pos += sizeof (MetaMethod))
+	{
+	    MetaMethod method;
+	    memcpy(&method, table + pos, sizeof method);
+	    if (!method) memcpy(table + pos,
+		    (const char *)bt->meta + pos, sizeof method);
+	}
+    }
+    t->resolved = table;
+    return table;
+}
+
+static void *slabAlloc(ObjectSlab *slab)
+{
+    char *block = slab->freeBlocks;
+    if (block)
+    {
+	memcpy(&slab->freeBlocks, block, sizeof slab->freeBlocks);
+	return block;
+    }
+    if (!slab->chunks || slab->used == SLABBLOCKS)
+    {
+	size_t chunksz = ALIGNED(sizeof (void *)) + SLABBLOCKS * slab->total;
+	char *chunk = PSC_malloc(chunksz);
+	memcpy(chunk, &slab->chunks, sizeof slab->chunks);
+	slab->chunks = chunk;
+	slab->used = 0;
+	slab->reserved += chunksz;
+    }
+    block = (char *)slab->chunks + ALIGNED(sizeof (void *))
+	+ slab->used++ * slab->total;
+    return block;
+}
+
+static void slabFree(ObjectSlab *slab, void *block)
+{
+    memcpy(block, &slab->freeBlocks, sizeof slab->freeBlocks);
+    slab->freeBlocks = block;
+}
+
+static void slabDestroy(ObjectSlab *slab)
+{
+    if (!slab) return;
+    void *chunk = slab->chunks;
+    while (chunk)
+    {
+	void *next;
+	memcpy(&next, chunk, sizeof next);
+	free(chunk);
+	chunk = next;
+    }
+    free(slab);
+}
+
+void *Object_alloc(uint32_t type, void *derived, size_t size)
+{
+    if (!derived)
+    {
+	MetaType *t = types + type;
+	ObjectSlab *slab = 0;
+	unsigned i;
+	for (i = 0; i < MAXLAYOUTS && t->slabs[i]; ++i)
+	{
+	    if (t->slabs[i]->dsize == size)
+	    {
+		slab = t->slabs[i];
+		break;
+	    }
+	}
+	if (slab && slab->total)
+	{
+	    char *block = slabAlloc(slab);
+	    building.owner = block;
+	    building.slab = slab;
+	    building.next = block + ALIGNED(size);
+	    building.end = block + slab->total;
+	    building.size = slab->total;
+	    return block;
+	}
+	if (!slab && i < MAXLAYOUTS)
+	{
+	    slab = PSC_malloc(sizeof *slab);
+	    memset(slab, 0, sizeof *slab);
+	    slab->dsize = size;
+	    t->slabs[i] = slab;
+	}
+	building.owner = PSC_malloc(size);
+	building.slab = slab;
+	building.next = 0;
+	building.end = 0;
+	building.size = ALIGNED(size);
+	return building.owner;
+    }
+    if (derived == building.owner)
+    {
+	if (!building.next) building.size += ALIGNED(size);
+	else
+	{
+	    /* All levels of a slab object must be carved from its block,
+	     * they are released with it */
+	    if (building.next + ALIGNED(size) > building.end)
+	    {
+		PSC_Service_panic("Bug: object layout changed!");
+	    }
+	    void *level = building.next;
+	    building.next += ALIGNED(size);
+	    return level;
+	}
+    }
+    return PSC_malloc(size);
+}
+
+void Object_free(void *ptr)
+{
+    /* Levels of an object allocated from a slab are released with its
+     * block after destroying all of them */
+    const Object *obj = ptr;
+    const ObjectBase *base = obj ? obj->root : 0;
+    if (base && base->block) return;
+    free(ptr);
+}
+
+static void destroyBase(void *obj)
+{
+    Object_free(obj);
 }
 
 Object *Object_createBase(void *derived)
 {
     ++objects;
-    ObjectBase *base = PSC_malloc(sizeof *base);
+    ObjectBase *base = 0;
+    void *block = 0;
+    ObjectSlab *slab = 0;
+    size_t size = 0;
+    if (derived && derived == building.owner)
+    {
+	if (building.next)
+	{
+	    if (building.next + ALIGNED(sizeof *base) > building.end)
+	    {
+		PSC_Service_panic("Bug: object layout changed!");
+	    }
+	    base = (ObjectBase *)building.next;
+	    block = building.owner;
+	    slab = building.slab;
+	}
+	else if (building.slab)
+	{
+	    /* first object of this layout, learn the size of all levels */
+	    building.slab->total = building.size + ALIGNED(sizeof *base);
+	}
+	size = block ? slab->total : building.size + ALIGNED(sizeof *base);
+	building.owner = 0;
+    }
+    if (!base) base = PSC_malloc(sizeof *base);
     base->base.base = 0;
+    base->base.root = base;
     base->base.type = 0;
     base->mostDerived = derived;
     base->owned = 0;
+    base->block = block;
+    base->slab = slab;
+    base->size = size;
+    base->nlevels = 0;
     base->refcnt = 1;
+    if (derived)
+    {
+	MetaType *t = types + ((Object *)derived)->type;
+	++t->created;
+	if (++t->live > t->peak) t->peak = t->live;
+	t->bytes += size;
+    }
     return (Object *)base;
 }
 
+static void indexLevels(ObjectBase *base)
+{
+    Object *chain[MAXLEVELS];
+    unsigned n = 0;
+    for (Object *obj = base->mostDerived; obj; obj = obj->base)
+    {
+	if (n == MAXLEVELS) return;
+	chain[n++] = obj;
+    }
+    if (chain[n-1] != &base->base) return;
+    for (unsigned i = 0; i < n; ++i)
+    {
+	Object *level = chain[n-1-i];
+	base->levels[i] = level;
+	types[level->type].depth = i;
+    }
+    base->nlevels = n;
+}
+
 void *Object_ref(void *self)
 {
     ObjectBase *base = Object_instanceOf(self, 0, 1);
@@ -74,6 +334,23 @@ void Object_own(void *self, void *obj)
 
 void *Object_instanceOf(void *self, uint32_t type, int mustMatch)
 {
+    ObjectBase *base = ((Object *)self)->root;
+    if (base)
+    {
+	if (!type) return base;
+
+	/* Once the object is complete, the level of a type is known */
+	if (!base->nlevels) indexLevels(base);
+	if (base->nlevels && type < typesnum)
+	{
+	    unsigned depth = types[type].depth;
+	    if (depth < base->nlevels && base->levels[depth]->type == type)
+	    {
+		return base->levels[depth];
+	    }
+	}
+    }
+
     int fromderived = !!type;
     Object *obj = fromderived ? Object_mostDerived(self) : self;
     while (obj)
@@ -109,7 +386,7 @@ static void destroyRecursive(Object *obj)
 {
     if (!obj) return;
     Object *base = obj->base;
-    MetaObject *m = types[obj->type];
+    MetaObject *m = types[obj->type].meta;
     m->destroy(obj);
     destroyRecursive(base);
 }
@@ -121,9 +398,31 @@ void Object_destroy(void *self)
     if (--base->refcnt) return;
     PSC_List_destroy(base->owned);
     Object *obj = base->mostDerived;
-    destroyRecursive(obj);
+    if (obj)
+    {
+	MetaType *t = types + obj->type;
+	--t->live;
+	t->bytes -= base->size;
+    }
+    void *block = base->block;
+    ObjectSlab *slab = base->slab;
+    if (block)
+    {
+	/* Object_free() skips the levels, they are released with the block */
+	destroyRecursive(obj);
+	slabFree(slab, block);
+    }
+    else destroyRecursive(obj);
     if (!--objects)
     {
+	for (uint32_t i = 0; i < typesnum; ++i)
+	{
+	    free(types[i].resolved);
+	    for (unsigned l = 0; l < MAXLAYOUTS; ++l)
+	    {
+		slabDestroy(types[i].slabs[l]);
+	    }
+	}
 	free(types);
 	types = 0;
 	typesnum = 0;
@@ -131,3 +430,23 @@ void Object_destroy(void *self)
     }
 }
 
+
+void Object_printStats(void)
+{
+    if (!typesnum) return;
+    fprintf(stderr, "  %-24s %8s %8s %8s %10s %10s\n", "class",
+	    "created", "live", "peak", "live bytes", "slab bytes");
+    for (uint32_t i = 1; i < typesnum; ++i)
+    {
+	const MetaType *t = types + i;
+	if (!t->created) continue;
+	size_t reserved = 0;
+	for (unsigned l = 0; l < MAXLAYOUTS; ++l)
+	{
+	    if (t->slabs[l]) reserved += t->slabs[l]->reserved;
+	}
+	fprintf(stderr, "  %-24s %8lu %8lu %8lu %10zu %10zu\n",
+		t->meta->name, t->created, t->live, t->peak,
+		t->bytes, reserved);
+    }
+}
@@ -1,6 +1,7 @@
 #ifndef XMOJI_OBJECT_H
 #define XMOJI_OBJECT_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 typedef struct MetaObject
@@ -19,12 +20,16 @@ typedef struct MetaObject
 typedef struct Object
 {
     void *base;
+    void *root;
     uint32_t type;
 } Object;
 
-uint32_t MetaObject_register(void *meta);
+uint32_t MetaObject_register(void *meta, size_t size);
 const void *MetaObject_get(uint32_t id);
+const void *MetaObject_resolved(const void *obj);
 
+void *Object_alloc(uint32_t type, void *derived, size_t size);
+void Object_free(void *ptr);
 Object *Object_createBase(void *derived);
 void *Object_ref(void *self);
 void Object_own(void *self, void *obj);
@@ -32,6 +37,7 @@ void *Object_instanceOf(void *self, uint32_t type, int mustMatch);
 void *Object_mostDerived(void *self);
 const char *Object_className(void *self);
 void Object_destroy(void *self);
+void Object_printStats(void);
 
 #define priv_MO_basector0(derived, type) \
     type ## _createBase (derived)
@@ -49,17 +55,26 @@ void Object_destroy(void *self);
 	priv_MO_basectorn,\
 	priv_MO_basector0,)(derived, __VA_ARGS__)
 
+#define NEWOBJ(size) \
+    Object_alloc(MetaObject_register(&mo, sizeof mo), derived, (size))
+
+#define priv_MO_root(b) ((b) ? ((Object *)(b))->root : 0)
+
 #define CREATEBASE(...) do { \
     if (!derived) derived = self; \
-    self->base.type = MetaObject_register(&mo); \
+    self->base.type = MetaObject_register(&mo, sizeof mo); \
     self->base.base = 0; \
+    self->base.root = 0; \
     self->base.base = priv_MO_basector(derived, __VA_ARGS__); \
+    self->base.root = priv_MO_root(self->base.base); \
 } while (0)
 
 #define CREATEFINALBASE(...) do { \
-    self->base.type = MetaObject_register(&mo); \
+    self->base.type = MetaObject_register(&mo, sizeof mo); \
     self->base.base = 0; \
+    self->base.root = 0; \
     self->base.base = priv_MO_basector(self, __VA_ARGS__); \
+    self->base.root = priv_MO_root(self->base.base); \
 } while (0)
 
 #define priv_MO_id ((MetaObject *)&mo)->id
@@ -74,8 +89,13 @@ void Object_destroy(void *self);
 #define priv_MO_base(...) ((Object *)priv_MO_first(__VA_ARGS__,))->base
 #define priv_MO_vcall(b, c, r, t, m, ...) do { \
     Object *mo_obj = b(__VA_ARGS__); \
+    const Meta ## t *mo_meta = MetaObject_resolved(mo_obj); \
+    if (mo_meta) { \
+	if (mo_meta->m) c(r, mo_meta, m, __VA_ARGS__); \
+	break; \
+    } \
     while (mo_obj) { \
-	const Meta ## t *mo_meta = MetaObject_get(mo_obj->type); \
+	mo_meta = MetaObject_get(mo_obj->type); \
 	if (!mo_meta) break; \
 	if (mo_meta->m) { \
 	    c(r, mo_meta, m, __VA_ARGS__); \
@@ -0,0 +1,183 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "profile.h"
+
+#include <inttypes.h>
+#include <poser/core.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAXSPANS 256
+#define MAXBENCHRUNS 100
+
+typedef struct ProfileSpan
+{
+    const char *phase;
+    char *detail;
+    uint64_t start;
+    uint64_t end;
+    unsigned depth;
+    int instant;
+} ProfileSpan;
+
+static ProfileSpan spans[MAXSPANS];
+static const char *tracefile;
+static uint64_t started;
+static unsigned benchruns;
+static unsigned nspans;
+static unsigned depth;
+static int active;
+
+static uint64_t nowus(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000U + ts.tv_nsec / 1000U;
+}
+
+static void writejsonstr(FILE *f, const char *str)
+{
+    fputc('"', f);
+    for (; *str; ++str)
+    {
+	if (*str == '"' || *str == '\\') fprintf(f, "\\%c", *str);
+	else if ((unsigned char)*str < 0x20)
+	{
+	    fprintf(f, "\\u%04x", (unsigned)*str);
+	}
+	else fputc(*str, f);
+    }
+    fputc('"', f);
+}
+
+static void writetrace(void)
+{
+    FILE *f = fopen(tracefile, "w");
+    if (!f)
+    {
+	PSC_Log_fmt(PSC_L_ERROR, "Cannot write startup trace to `%s'",
+		tracefile);
+	return;
+    }
+    long pid = (long)getpid();
+    fputs("{\"traceEvents\":[\n", f);
+    for (unsigned i = 0; i < nspans; ++i)
+    {
+	const ProfileSpan *span = spans + i;
+	fputs("{\"name\":", f);
+	writejsonstr(f, span->phase);
+	fprintf(f, ",\"cat\":\"startup\",\"pid\":%ld,\"tid\":%ld,"
+		"\"ts\":%"PRIu64, pid, pid, span->start - started);
+	if (span->instant) fputs(",\"ph\":\"i\",\"s\":\"p\"", f);
+	else fprintf(f, ",\"ph\":\"X\",\"dur\":%"PRIu64,
+		span->end - span->start);
+	if (span->detail)
+	{
+	    fputs(",\"args\":{\"detail\":", f);
+	    writejsonstr(f, span->detail);
+	    fputc('}', f);
+	}
+	fprintf(f, "}%s\n", i < nspans - 1 ? "," : "");
+    }
+    fputs("]}\n", f);
+    fclose(f);
+    PSC_Log_fmt(PSC_L_INFO, "Startup trace written to `%s'", tracefile);
+}
+
+void Profile_init(int argc, char **argv)
+{
+    if (active || started) return;
+    for (int i = 1; i < argc; ++i)
+    {
+	if (!strcmp(argv[i], "-profile")) active = 1;
+	else if (i < argc - 1 && !strcmp(argv[i], "-profiletrace"))
+	{
+	    active = 1;
+	    tracefile = argv[++i];
+	}
+	else if (i < argc - 1 && !strcmp(argv[i], "-drawbench"))
+	{
+	    active = 1;
+	    benchruns = atoi(argv[++i]);
+	    if (benchruns > MAXBENCHRUNS) benchruns = MAXBENCHRUNS;
+	}
+    }
+    if (active) started = nowus();
+}
+
+int Profile_active(void)
+{
+    return active;
+}
+
+int Profile_begin(const char *phase, const char *detail)
+{
+    if (!active || nspans == MAXSPANS) return -1;
+    ProfileSpan *span = spans + nspans;
+    span->phase = phase;
+    span->detail = detail ? PSC_copystr(detail) : 0;
+    span->start = nowus();
+    span->end = 0;
+    span->depth = depth++;
+    span->instant = 0;
+    return nspans++;
+}
+
+void Profile_end(int span)
+{
+    if (!active || span < 0) return;
+    spans[span].end = nowus();
+    if (depth) --depth;
+}
+
+void Profile_mark(const char *event)
+{
+    if (!active || nspans == MAXSPANS) return;
+    ProfileSpan *span = spans + nspans++;
+    span->phase = event;
+    span->detail = 0;
+    span->start = span->end = nowus();
+    span->depth = depth;
+    span->instant = 1;
+}
+
+void Profile_finish(void)
+{
+    if (!active) return;
+    active = 0;
+    uint64_t finished = nowus();
+
+    fprintf(stderr, "Startup profile, total %.3f ms:\n",
+	    (double)(finished - started) / 1000.);
+    for (unsigned i = 0; i < nspans; ++i)
+    {
+	ProfileSpan *span = spans + i;
+
+	/* Phases left by an error path end when profiling ends */
+	if (!span->end) span->end = finished;
+	fprintf(stderr, "  %9.3f ms ", (double)(span->start - started) / 1000.);
+	if (span->instant) fputs("           ", stderr);
+	else fprintf(stderr, "+%9.3f ", (double)(span->end - span->start)
+		/ 1000.);
+	fprintf(stderr, "%*s%s%s%s%s\n", 2 * span->depth, "",
+		span->instant ? "* " : "", span->phase,
+		span->detail ? ": " : "", span->detail ? span->detail : "");
+    }
+    fflush(stderr);
+    if (tracefile) writetrace();
+
+    for (unsigned i = 0; i < nspans; ++i) free(spans[i].detail);
+    nspans = 0;
+    depth = 0;
+}
+
+unsigned Profile_benchmarkRuns(void)
+{
+    unsigned runs = benchruns;
+    benchruns = 0;
+    return runs;
+}
@@ -0,0 +1,16 @@
+#ifndef XMOJI_PROFILE_H
+#define XMOJI_PROFILE_H
+
+#include <poser/decl.h>
+
+void Profile_init(int argc, char **argv);
+int Profile_active(void);
+int Profile_begin(const char *phase, const char *detail)
+    ATTR_NONNULL((1));
+void Profile_end(int span);
+void Profile_mark(const char *event)
+    ATTR_NONNULL((1));
+void Profile_finish(void);
+unsigned Profile_benchmarkRuns(void);
+
+#endif
@@ -113,7 +113,7 @@ static void destroy(void *obj)
 {
     ScrollBox *self = obj;
     if (!self->backingstore) Object_destroy(self->widget);
-    free(self);
+    Object_free(self);
 }
 
 static void expose(void *obj, Rect region)
@@ -346,7 +346,7 @@ static void sizeRequested(void *receiver, void *sender, void *args)
 
 ScrollBox *ScrollBox_createBase(void *derived, const char *name, void *parent)
 {
-    ScrollBox *self = PSC_malloc(sizeof *self);
+    ScrollBox *self = NEWOBJ(sizeof *self);
     CREATEBASE(Widget, name, parent);
     XRdb *rdb = X11Adapter_resources();
     const char *resname = Widget_resname(self);
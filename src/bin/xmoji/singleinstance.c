@@ -3,25 +3,46 @@
 #include "singleinstance.h"
 #include "x11app.h"
 
+#include <errno.h>
 #include <poser/core.h>
 #include <pwd.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 #define FNV1A_INIT64	0xcbf29ce484222325ULL
 #define FNV1A_PRIME64	0x100000001b3ULL
 #define B64HASHSZ	12
+#define FRAMEHDRSZ	3
+#define MAXPENDING	(4 * (FRAMEHDRSZ + 0xffffU))
+#define CLIENTTIMEOUT	2
 
 struct SingleInstance
 {
     PSC_Event *secondary;
+    PSC_Event *command;
     char *sockname;
     PSC_Server *server;
+    int client;
 };
 
+/* A connected secondary instance, commands are handled one at a time, the
+ * next one is only read after the reply to the previous one was sent */
+typedef struct Client
+{
+    SingleInstance *instance;
+    PSC_Connection *conn;
+    uint8_t *buf;
+    size_t buflen;
+    uint8_t *reply;
+    unsigned commands;
+} Client;
+
 /* slightly modified base64 digits:
  * avoid '/', so the result can be used for a file name */
 static const char mb64[64] =
@@ -54,24 +75,118 @@ SingleInstance *SingleInstance_create(void)
 {
     SingleInstance *self = PSC_malloc(sizeof *self);
     self->secondary = PSC_Event_create(self);
+    self->command = PSC_Event_create(self);
     self->server = 0;
     self->sockname = 0;
+    self->client = -1;
     return self;
 }
 
+static void deleteClient(void *obj)
+{
+    Client *self = obj;
+    free(self->reply);
+    free(self->buf);
+    free(self);
+}
+
+static void handleFrames(Client *self)
+{
+    while (!self->reply && self->buflen >= FRAMEHDRSZ)
+    {
+	size_t len = (self->buf[1] << 8) | self->buf[2];
+	if (self->buflen < FRAMEHDRSZ + len) break;
+	char *arg = PSC_malloc(len + 1);
+	memcpy(arg, self->buf + FRAMEHDRSZ, len);
+	arg[len] = 0;
+	SingleInstanceCommandEventArgs ea = { self->buf[0], arg, 0, 0 };
+	self->buflen -= FRAMEHDRSZ + len;
+	memmove(self->buf, self->buf + FRAMEHDRSZ + len, self->buflen);
+	++self->commands;
+	if (ea.command < SIC_SHOW || ea.command > SIC_HISTORY) ea.failed = 1;
+	else PSC_Event_raise(self->instance->command, 0, &ea);
+	free(arg);
+
+	len = ea.reply ? strlen(ea.reply) : 0;
+	if (len > 0xffffU) len = 0xffffU;
+	self->reply = PSC_malloc(FRAMEHDRSZ + len);
+	self->reply[0] = !!ea.failed;
+	self->reply[1] = len >> 8;
+	self->reply[2] = len & 0xffU;
+	if (len) memcpy(self->reply + FRAMEHDRSZ, ea.reply, len);
+	free(ea.reply);
+	if (PSC_Connection_sendAsync(self->conn, self->reply,
+		    FRAMEHDRSZ + len, self) < 0)
+	{
+	    PSC_Connection_close(self->conn, 0);
+	}
+    }
+}
+
+static void clientData(void *receiver, void *sender, void *args)
+{
+    (void)sender;
+
+    Client *self = receiver;
+    PSC_EADataReceived *ea = args;
+    size_t sz = PSC_EADataReceived_size(ea);
+    PSC_EADataReceived_markHandled(ea);
+    if (self->buflen + sz > MAXPENDING)
+    {
+	PSC_Log_msg(PSC_L_WARNING, "SingleInstance: Too much pending data "
+		"from client, closing connection");
+	PSC_Connection_close(self->conn, 0);
+	return;
+    }
+    self->buf = PSC_realloc(self->buf, self->buflen + sz);
+    memcpy(self->buf + self->buflen, PSC_EADataReceived_buf(ea), sz);
+    self->buflen += sz;
+    handleFrames(self);
+}
+
+static void clientSent(void *receiver, void *sender, void *args)
+{
+    (void)sender;
+
+    Client *self = receiver;
+    if (args != self) return;
+    free(self->reply);
+    self->reply = 0;
+    handleFrames(self);
+}
+
+static void clientClosed(void *receiver, void *sender, void *args)
+{
+    (void)sender;
+    (void)args;
+
+    /* A client closing without sending any command just wants the running
+     * instance to show up */
+    Client *self = receiver;
+    if (!self->commands) PSC_Event_raise(self->instance->secondary, 0, 0);
+}
+
 static void onconnected(void *receiver, void *sender, void *args)
 {
     (void)sender;
 
     SingleInstance *self = receiver;
     PSC_Connection *conn = args;
-    PSC_Connection_close(conn, 0);
-    PSC_Event_raise(self->secondary, 0, 0);
+    Client *client = PSC_malloc(sizeof *client);
+    memset(client, 0, sizeof *client);
+    client->instance = self;
+    client->conn = conn;
+    PSC_Connection_setData(conn, client, deleteClient);
+    PSC_Event_register(PSC_Connection_dataReceived(conn), client,
+	    clientData, 0);
+    PSC_Event_register(PSC_Connection_dataSent(conn), client,
+	    clientSent, 0);
+    PSC_Event_register(PSC_Connection_closed(conn), client,
+	    clientClosed, 0);
 }
 
-int SingleInstance_start(SingleInstance *self)
+static const char *sockName(SingleInstance *self)
 {
-    if (self->server) return 1;
     if (!self->sockname)
     {
 	const char *hostname = X11App_hostname();
@@ -96,7 +211,13 @@ int SingleInstance_start(SingleInstance *self)
 	snprintf(self->sockname, socknamesz, "%s/%s_%s",
 		tmpdir, basename, hash);
     }
-    PSC_UnixServerOpts *opts = PSC_UnixServerOpts_create(self->sockname);
+    return self->sockname;
+}
+
+int SingleInstance_start(SingleInstance *self)
+{
+    if (self->server) return 1;
+    PSC_UnixServerOpts *opts = PSC_UnixServerOpts_create(sockName(self));
     PSC_Log_setSilent(1);
     self->server = PSC_Server_createUnix(opts);
     PSC_Log_setSilent(0);
@@ -116,16 +237,86 @@ void SingleInstance_stop(SingleInstance *self)
     self->server = 0;
 }
 
+static int transfer(int fd, uint8_t *buf, size_t sz, int out)
+{
+    while (sz)
+    {
+	ssize_t rc = out ? write(fd, buf, sz) : read(fd, buf, sz);
+	if (rc < 0 && errno == EINTR) continue;
+	if (rc <= 0) return -1;
+	buf += rc;
+	sz -= rc;
+    }
+    return 0;
+}
+
+static int connectClient(SingleInstance *self)
+{
+    const char *sockname = sockName(self);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (strlen(sockname) >= sizeof addr.sun_path) return -1;
+    strcpy(addr.sun_path, sockname);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    struct timeval timeout = { CLIENTTIMEOUT, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof addr) < 0)
+    {
+	close(fd);
+	return -1;
+    }
+    self->client = fd;
+    return 0;
+}
+
+int SingleInstance_send(SingleInstance *self, SingleInstanceCommand command,
+	const char *arg, char **reply)
+{
+    size_t len = arg ? strlen(arg) : 0;
+    if (len > 0xffffU) return -1;
+    if (self->client < 0 && connectClient(self) < 0) return -1;
+    uint8_t hdr[FRAMEHDRSZ] = { command, len >> 8, len & 0xffU };
+    if (transfer(self->client, hdr, FRAMEHDRSZ, 1) < 0
+	    || transfer(self->client, (uint8_t *)arg, len, 1) < 0
+	    || transfer(self->client, hdr, FRAMEHDRSZ, 0) < 0) goto fail;
+    len = (hdr[1] << 8) | hdr[2];
+    char *payload = PSC_malloc(len + 1);
+    if (transfer(self->client, (uint8_t *)payload, len, 0) < 0)
+    {
+	free(payload);
+	goto fail;
+    }
+    payload[len] = 0;
+    if (reply && !hdr[0]) *reply = payload;
+    else free(payload);
+    return !!hdr[0];
+
+fail:
+    close(self->client);
+    self->client = -1;
+    return -1;
+}
+
 PSC_Event *SingleInstance_secondary(SingleInstance *self)
 {
     return self->secondary;
 }
 
+PSC_Event *SingleInstance_command(SingleInstance *self)
+{
+    return self->command;
+}
+
 void SingleInstance_destroy(SingleInstance *self)
 {
     if (!self) return;
+    if (self->client >= 0) close(self->client);
     free(self->sockname);
     PSC_Server_destroy(self->server);
+    PSC_Event_destroy(self->command);
     PSC_Event_destroy(self->secondary);
     free(self);
 }
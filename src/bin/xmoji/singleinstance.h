@@ -6,11 +6,38 @@
 C_CLASS_DECL(PSC_Event);
 C_CLASS_DECL(SingleInstance);
 
+/* Commands a secondary instance can send to the running one. On the
+ * socket, every command and every reply is a frame of one type byte, the
+ * payload length as 16bit big-endian number and the UTF-8 payload. A reply
+ * has type 0 on success. */
+typedef enum SingleInstanceCommand
+{
+    SIC_SHOW = 1,	/* Show the main window */
+    SIC_SHOWATPOINTER,	/* Show the main window at the mouse pointer */
+    SIC_SEARCH,		/* Show search results for the payload */
+    SIC_INJECT,		/* Send the emoji given as payload */
+    SIC_HISTORY		/* Reply with the recently used emojis */
+} SingleInstanceCommand;
+
+typedef struct SingleInstanceCommandEventArgs
+{
+    SingleInstanceCommand command;
+    const char *arg;
+    char *reply;	/* may be set by a handler, will be free()d */
+    int failed;		/* set by a handler for an unusable command */
+} SingleInstanceCommandEventArgs;
+
 SingleInstance *SingleInstance_create(void) ATTR_RETNONNULL;
 int SingleInstance_start(SingleInstance *self) CMETHOD;
 void SingleInstance_stop(SingleInstance *self) CMETHOD;
+/* Send a command to the running instance, returns 0 on success, 1 if the
+ * command failed and -1 if there is no running instance to talk to */
+int SingleInstance_send(SingleInstance *self, SingleInstanceCommand command,
+	const char *arg, char **reply) CMETHOD;
 PSC_Event *SingleInstance_secondary(SingleInstance *self)
     CMETHOD ATTR_RETNONNULL;
+PSC_Event *SingleInstance_command(SingleInstance *self)
+    CMETHOD ATTR_RETNONNULL;
 void SingleInstance_destroy(SingleInstance *self);
 
 #endif
@@ -59,7 +59,7 @@ static void destroy(void *obj)
     Shape_destroy(self->uparrow);
     Pen_destroy(self->pen);
     PSC_Event_destroy(self->changed);
-    free(self);
+    Object_free(self);
 }
 
 static UniStr *valstr(int value)
@@ -395,7 +395,7 @@ static void textChanged(void *receiver, void *sender, void *args)
 SpinBox *SpinBox_createBase(void *derived, const char *name,
 	int min, int max, int step, void *parent)
 {
-    SpinBox *self = PSC_malloc(sizeof *self);
+    SpinBox *self = NEWOBJ(sizeof *self);
     CREATEBASE(Widget, name, parent);
     self->textBox = TextBox_create(name, self);
     self->changed = PSC_Event_create(self);
@@ -37,7 +37,7 @@ static void destroy(void *obj)
 	xcb_render_free_picture(c, self->pic);
 	xcb_free_pixmap(c, self->p);
     }
-    free(self);
+    Object_free(self);
 }
 
 static void expose(void *obj, Rect region)
@@ -152,7 +152,7 @@ static void sizeRequested(void *receiver, void *sender, void *args)
 
 Surface *Surface_createBase(void *derived, void *parent)
 {
-    Surface *self = PSC_malloc(sizeof *self);
+    Surface *self = NEWOBJ(sizeof *self);
     CREATEBASE(Widget, 0, parent);
     self->widget = 0;
     self->p = 0;
@@ -27,6 +27,7 @@ typedef struct Tab
     TabBox *box;
     Widget *buttonWidget;
     Widget *contentWidget;
+    Font *pendingFont;
     Rect tabGeom;
     Size buttonMinSize;
     Size contentMinSize;
@@ -48,7 +49,7 @@ static void destroy(void *obj)
 {
     TabBox *self = obj;
     PSC_List_destroy(self->tabs);
-    free(self);
+    Object_free(self);
 }
 
 static void layout(TabBox *self)
@@ -65,6 +66,7 @@ static void layout(TabBox *self)
 	{
 	    barSize.height = tab->buttonMinSize.height;
 	}
+	if (tab->pendingFont) continue;
 	if (tab->contentMinSize.width > contentSize.width)
 	{
 	    contentSize.width = tab->contentMinSize.width;
@@ -273,9 +275,38 @@ static void setFont(void *obj, Font *font)
     {
 	Tab *tab = PSC_ListIterator_current(i);
 	Widget_offerFont(tab->buttonWidget, font);
-	Widget_offerFont(tab->contentWidget, font);
+	Font_destroy(tab->pendingFont);
+	tab->pendingFont = 0;
+	if (tab->index == self->currentIndex)
+	{
+	    Widget_offerFont(tab->contentWidget, font);
+	}
+	else
+	{
+	    /* Contents of hidden tabs get the new font only once they
+	     * are selected, so their glyphs aren't rendered before */
+	    tab->pendingFont = Font_ref(font);
+	}
     }
     PSC_ListIterator_destroy(i);
+    layout(self);
+}
+
+static void selectTab(TabBox *self, int index)
+{
+    self->currentIndex = index;
+    if (index >= 0)
+    {
+	Tab *tab = PSC_List_at(self->tabs, index);
+	if (tab->pendingFont)
+	{
+	    Font *font = tab->pendingFont;
+	    tab->pendingFont = 0;
+	    Widget_offerFont(tab->contentWidget, font);
+	    Font_destroy(font);
+	}
+    }
+    layout(self);
 }
 
 static Widget *childAt(void *obj, Pos pos)
@@ -349,8 +380,7 @@ static int clicked(void *obj, const ClickEvent *event)
 	    }
 	    if (event->button == MB_LEFT)
 	    {
-		self->currentIndex = tab->index;
-		layout(self);
+		selectTab(self, tab->index);
 		handled = 1;
 	    }
 	    break;
@@ -388,7 +418,7 @@ static void sizeRequested(void *receiver, void *sender, void *args)
 
 TabBox *TabBox_createBase(void *derived, const char *name, void *parent)
 {
-    TabBox *self = PSC_malloc(sizeof *self);
+    TabBox *self = NEWOBJ(sizeof *self);
     CREATEBASE(Widget, name, parent);
     self->tabs = PSC_List_create();
     self->hovered = 0;
@@ -413,6 +443,7 @@ static void destroyTab(void *obj)
 	    sizeRequested, 0);
     Object_destroy(self->contentWidget);
     Object_destroy(self->buttonWidget);
+    Font_destroy(self->pendingFont);
     free(self);
 }
 
@@ -423,6 +454,7 @@ void TabBox_addTab(void *self, void *buttonWidget, void *contentWidget)
     tab->box = b;
     tab->buttonWidget = Object_ref(Widget_cast(buttonWidget));
     tab->contentWidget = Object_ref(Widget_cast(contentWidget));
+    tab->pendingFont = 0;
     tab->buttonMinSize = Widget_minSize(tab->buttonWidget);
     tab->contentMinSize = Widget_minSize(tab->contentWidget);
     tab->index = PSC_List_size(b->tabs);
@@ -449,9 +481,5 @@ void TabBox_setTab(void *self, int index)
     else if (index < 0) index = 0;
     else if ((size_t)index >= ntabs) index = ntabs - 1;
 
-    if (index != b->currentIndex)
-    {
-	b->currentIndex = index;
-	layout(b);
-    }
+    if (index != b->currentIndex) selectTab(b, index);
 }
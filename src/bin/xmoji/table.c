@@ -25,7 +25,7 @@ static void destroy(void *obj)
 {
     Table *self = obj;
     free(self->minWidth);
-    free(self);
+    Object_free(self);
 }
 
 static void layout(void *vbox, int updateMinSize)
@@ -83,7 +83,7 @@ static void layout(void *vbox, int updateMinSize)
 
 Table *Table_createBase(void *derived, void *parent)
 {
-    Table *self = PSC_malloc(sizeof *self);
+    Table *self = NEWOBJ(sizeof *self);
     CREATEBASE(VBox, parent);
     self->cols = 0;
     self->minWidth = 0;
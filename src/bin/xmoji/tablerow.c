@@ -1,13 +1,12 @@
 #include "tablerow.h"
 
 #include <poser/core.h>
-#include <stdlib.h>
 
 static MetaTableRow mo = MetaTableRow_init(
 	0, 0, 0, 0,
 	0, 0, 0, 0, 0, 0, 0,
 	0, 0, 0, 0, 0, 0, 0,
-	"TableRow", free);
+	"TableRow", Object_free);
 
 struct TableRow
 {
@@ -16,7 +15,7 @@ struct TableRow
 
 TableRow *TableRow_createBase(void *derived, void *parent)
 {
-    TableRow *self = PSC_malloc(sizeof *self);
+    TableRow *self = NEWOBJ(sizeof *self);
     CREATEBASE(HBox, parent);
     return self;
 }
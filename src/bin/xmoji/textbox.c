@@ -102,7 +102,7 @@ static void destroy(void *obj)
     UniStr_destroy(self->selected);
     TextRenderer_destroy(self->renderer);
     UniStrBuilder_destroy(self->text);
-    free(self);
+    Object_free(self);
 }
 
 static xcb_render_picture_t renderClearbtn(void *obj,
@@ -373,6 +373,9 @@ static void keyPressed(void *obj, const KeyEvent *event)
     const UniStr *str = UniStrBuilder_stringView(self->text);
     size_t len = UniStr_len(str);
     unsigned glen;
+    unsigned editpos = 0;
+    unsigned editdel = 0;
+    unsigned editins = 0;
     Selection oldSelection = self->selection;
 
     switch (event->keysym)
@@ -383,6 +386,8 @@ static void keyPressed(void *obj, const KeyEvent *event)
 		self->cursor = self->selection.start;
 		UniStrBuilder_remove(self->text, self->cursor,
 			self->selection.len);
+		editpos = self->cursor;
+		editdel = self->selection.len;
 		self->selection.len = 0;
 		break;
 	    }
@@ -390,6 +395,8 @@ static void keyPressed(void *obj, const KeyEvent *event)
 	    glen = TextRenderer_glyphLen(self->renderer, self->cursor);
 	    self->cursor -= glen;
 	    UniStrBuilder_remove(self->text, self->cursor, glen);
+	    editpos = self->cursor;
+	    editdel = glen;
 	    break;
 
 	case XKB_KEY_Delete:
@@ -398,12 +405,16 @@ static void keyPressed(void *obj, const KeyEvent *event)
 		self->cursor = self->selection.start;
 		UniStrBuilder_remove(self->text, self->cursor,
 			self->selection.len);
+		editpos = self->cursor;
+		editdel = self->selection.len;
 		self->selection.len = 0;
 		break;
 	    }
 	    if (!len || self->cursor == len) return;
 	    glen = TextRenderer_glyphLen(self->renderer, self->cursor + 1);
 	    UniStrBuilder_remove(self->text, self->cursor, glen);
+	    editpos = self->cursor;
+	    editdel = glen;
 	    break;
 
 	case XKB_KEY_Left:
@@ -526,10 +537,13 @@ static void keyPressed(void *obj, const KeyEvent *event)
 	    {
 		cursor = self->selection.start;
 		UniStrBuilder_remove(mod, cursor, self->selection.len);
+		editdel = self->selection.len;
 	    }
+	    editpos = cursor;
 	    if (len < self->maxlen)
 	    {
 		UniStrBuilder_insertChar(mod, cursor++, event->codepoint);
+		editins = 1;
 	    }
 	    if (self->filter)
 	    {
@@ -551,7 +565,7 @@ static void keyPressed(void *obj, const KeyEvent *event)
 	    if (self->clear && !len) updatehover(self, self->lastPos);
 	    break;
     }
-    TextRenderer_setText(self->renderer, str);
+    TextRenderer_editText(self->renderer, str, editpos, editdel, editins);
     PSC_Event_raise(self->textChanged, 0, (void *)str);
 cursoronly:
     self->cursorvisible = 1;
@@ -590,8 +604,8 @@ static void paste(void *obj, XSelectionContent content)
 	    return;
 	}
     }
+    TextRenderer_editText(self->renderer, str, self->cursor, 0, inslen);
     self->cursor += inslen;
-    TextRenderer_setText(self->renderer, str);
     PSC_Event_raise(self->textChanged, 0, (void *)str);
     Widget_invalidate(self);
     if (self->clear && !len) updatehover(self, self->lastPos);
@@ -757,7 +771,7 @@ static void dragged(void *obj, const DragEvent *event)
 
 TextBox *TextBox_createBase(void *derived, const char *name, void *parent)
 {
-    TextBox *self = PSC_malloc(sizeof *self);
+    TextBox *self = NEWOBJ(sizeof *self);
     CREATEBASE(Widget, name, parent);
     self->filter = 0;
     self->filterobj = 0;
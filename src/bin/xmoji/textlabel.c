@@ -83,7 +83,7 @@ static void destroy(void *obj)
     TextLabel *self = obj;
     PSC_List_destroy(self->renderers);
     UniStr_destroy(self->text);
-    free(self);
+    Object_free(self);
 }
 
 static int draw(void *obj, xcb_render_picture_t picture)
@@ -131,7 +131,7 @@ static Size minSize(const void *obj)
 
 TextLabel *TextLabel_createBase(void *derived, const char *name, void *parent)
 {
-    TextLabel *self = PSC_malloc(sizeof *self);
+    TextLabel *self = NEWOBJ(sizeof *self);
     CREATEBASE(Widget, name, parent);
     self->text = 0;
     self->renderers = PSC_List_create();
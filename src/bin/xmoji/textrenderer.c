@@ -29,25 +29,29 @@ struct TextRenderer
     GlyphRenderInfo *glyphs;
     Pen *pen;
     xcb_render_picture_t tpic;
+    hb_script_t hbscript;
+    hb_direction_t hbdirection;
     Color color;
     Color tcolor;
     Color scolor;
     Size size;
+    Size tpicsize;
     Pos pos;
     Selection selection;
+    unsigned textlen;
     unsigned hblen;
+    unsigned hbcapa;
     int noligatures;
     int underline;
     int uploaded;
+    int tpicvalid;
 };
 
 static void clearRenderer(TextRenderer *self)
 {
-    free(self->glyphs);
-    self->glyphs = 0;
+    self->textlen = 0;
+    self->hblen = 0;
     self->uploaded = 0;
-    hb_buffer_destroy(self->hbbuffer);
-    self->hbbuffer = 0;
     hb_font_destroy(self->hbfont);
     self->hbfont = 0;
     if (self->tpic)
@@ -55,6 +59,7 @@ static void clearRenderer(TextRenderer *self)
 	xcb_render_free_picture(X11Adapter_connection(), self->tpic);
     }
     self->tpic = 0;
+    self->tpicvalid = 0;
     Font_destroy(self->font);
     self->font = 0;
 }
@@ -99,20 +104,45 @@ Font *TextRenderer_font(TextRenderer *self)
     return self->font;
 }
 
-static void createTmpPicture(TextRenderer *self, xcb_connection_t *c)
+static void prepareTmpPicture(TextRenderer *self, xcb_connection_t *c)
 {
     xcb_render_picture_t ownerpic = Widget_picture(self->owner);
-    xcb_pixmap_t tmp = xcb_generate_id(c);
-    CHECK(xcb_create_pixmap(c, 24, tmp, X11Adapter_screen()->root,
-		self->size.width, self->size.height),
-	    "TextRenderer: Cannot create temporary pixmap for 0x%x",
-	    (unsigned)ownerpic);
-    self->tpic = xcb_generate_id(c);
-    CHECK(xcb_render_create_picture(c, self->tpic, tmp,
-		X11Adapter_format(PICTFORMAT_RGB), 0, 0),
-	    "TextRenderer: Cannot create temporary picture for 0x%x",
-	    (unsigned)ownerpic);
-    xcb_free_pixmap(c, tmp);
+    if (self->tpic && (self->size.width > self->tpicsize.width
+		|| self->size.height > self->tpicsize.height))
+    {
+	xcb_render_free_picture(c, self->tpic);
+	self->tpic = 0;
+    }
+    if (!self->tpic)
+    {
+	/* Leave some room, so the picture can be reused while typing */
+	self->tpicsize.width = (self->size.width + 0x3fU) & ~0x3fU;
+	self->tpicsize.height = self->size.height;
+	xcb_pixmap_t tmp = xcb_generate_id(c);
+	CHECK(xcb_create_pixmap(c, 24, tmp, X11Adapter_screen()->root,
+		    self->tpicsize.width, self->tpicsize.height),
+		"TextRenderer: Cannot create temporary pixmap for 0x%x",
+		(unsigned)ownerpic);
+	self->tpic = xcb_generate_id(c);
+	CHECK(xcb_render_create_picture(c, self->tpic, tmp,
+		    X11Adapter_format(PICTFORMAT_RGB), 0, 0),
+		"TextRenderer: Cannot create temporary picture for 0x%x",
+		(unsigned)ownerpic);
+	xcb_free_pixmap(c, tmp);
+	if (X11Adapter_glitches() & XG_RENDER_SRC_OFFSET)
+	{
+	    self->pos = (Pos){0, 0};
+	}
+    }
+    else if (Font_glyphtype(self->font) == FGT_BITMAP_BGRA)
+    {
+	xcb_rectangle_t rect = { 0, 0,
+	    self->tpicsize.width, self->tpicsize.height };
+	CHECK(xcb_render_fill_rectangles(c, XCB_RENDER_PICT_OP_SRC,
+		    self->tpic, Color_xcb(0), 1, &rect),
+		"TextRenderer: Cannot clear temporary picture for 0x%x",
+		(unsigned)ownerpic);
+    }
     if (Font_glyphtype(self->font) == FGT_BITMAP_BGRA)
     {
 	CHECK(xcb_render_composite_glyphs_32(c, XCB_RENDER_PICT_OP_IN,
@@ -123,41 +153,56 @@ static void createTmpPicture(TextRenderer *self, xcb_connection_t *c)
 		"TextRenderer: Cannot render glyphs for 0x%x",
 		(unsigned)ownerpic);
     }
-    if (X11Adapter_glitches() & XG_RENDER_SRC_OFFSET)
-    {
-	self->pos = (Pos){0, 0};
-    }
+    self->tpicvalid = 1;
 }
 
-int TextRenderer_setText(TextRenderer *self, const UniStr *text)
+static void reserveGlyphs(TextRenderer *self, unsigned len)
+{
+    if (len <= self->hbcapa) return;
+    while (len > self->hbcapa) self->hbcapa += 32;
+    self->hbglyphs = PSC_realloc(self->hbglyphs,
+	    self->hbcapa * sizeof *self->hbglyphs);
+    self->hbpos = PSC_realloc(self->hbpos,
+	    self->hbcapa * sizeof *self->hbpos);
+    self->glyphs = PSC_realloc(self->glyphs,
+	    self->hbcapa * sizeof *self->glyphs);
+}
+
+static void shape(TextRenderer *self)
 {
-    if (!self->font) return -1;
-    hb_buffer_destroy(self->hbbuffer);
-    unsigned len = UniStr_len(text);
-    if (!len)
-    {
-	self->hbbuffer = 0;
-	self->hbglyphs = 0;
-	self->hbpos = 0;
-	self->size = (Size){0, 0};
-	self->hblen = 0;
-	return 0;
-    }
-    self->hbbuffer = hb_buffer_create();
-    hb_buffer_add_codepoints(self->hbbuffer, UniStr_str(text), len, 0, -1);
-    hb_buffer_set_language(self->hbbuffer, hb_language_from_string("en", -1));
-    hb_buffer_guess_segment_properties(self->hbbuffer);
     if (self->noligatures) hb_shape(self->hbfont, self->hbbuffer, &nolig, 1);
     else hb_shape(self->hbfont, self->hbbuffer, 0, 0);
-    self->hblen = hb_buffer_get_length(self->hbbuffer);
-    self->hbglyphs = hb_buffer_get_glyph_infos(self->hbbuffer, 0);
-    self->hbpos = hb_buffer_get_glyph_positions(self->hbbuffer, 0);
+}
+
+static void guessProperties(TextRenderer *self, const UniStr *text)
+{
+    if (!self->hbbuffer) self->hbbuffer = hb_buffer_create();
+    else hb_buffer_clear_contents(self->hbbuffer);
+    hb_buffer_add_codepoints(self->hbbuffer, UniStr_str(text),
+	    UniStr_len(text), 0, -1);
+    hb_buffer_set_language(self->hbbuffer, hb_language_from_string("en", -1));
+    hb_buffer_guess_segment_properties(self->hbbuffer);
+}
+
+static void takeGlyphs(TextRenderer *self)
+{
+    unsigned len = hb_buffer_get_length(self->hbbuffer);
+    reserveGlyphs(self, len);
+    memcpy(self->hbglyphs, hb_buffer_get_glyph_infos(self->hbbuffer, 0),
+	    len * sizeof *self->hbglyphs);
+    memcpy(self->hbpos, hb_buffer_get_glyph_positions(self->hbbuffer, 0),
+	    len * sizeof *self->hbpos);
+    self->hblen = len;
+}
+
+static void layoutGlyphs(TextRenderer *self)
+{
     uint32_t width = 0;
     uint32_t height = 0;
     FT_Face face = Font_face(self->font);
     FT_Load_Glyph(face, self->hbglyphs[self->hblen-1].codepoint,
 	    Font_ftLoadFlags(self->font));
-    if (HB_DIRECTION_IS_HORIZONTAL(hb_buffer_get_direction(self->hbbuffer)))
+    if (HB_DIRECTION_IS_HORIZONTAL(self->hbdirection))
     {
 	for (unsigned i = 0; i < self->hblen - 1; ++i)
 	{
@@ -181,14 +226,6 @@ int TextRenderer_setText(TextRenderer *self, const UniStr *text)
     if (!self->size.width) self->size.width = 1;
     self->size.height = (height + 0x3fU) >> 6;
     if (!self->size.height) self->size.height = 1;
-    xcb_connection_t *c = X11Adapter_connection();
-    if (self->tpic)
-    {
-	xcb_render_free_picture(c, self->tpic);
-	self->tpic = 0;
-    }
-    free(self->glyphs);
-    self->glyphs = PSC_malloc(self->hblen * sizeof *self->glyphs);
     memset(self->glyphs, 0, self->hblen * sizeof *self->glyphs);
     uint32_t x = 0;
     uint32_t y = Font_baseline(self->font);
@@ -219,7 +256,138 @@ int TextRenderer_setText(TextRenderer *self, const UniStr *text)
 	y += self->hbpos[i].y_advance;
     }
     self->uploaded = 0;
+    self->tpicvalid = 0;
     self->selection = (Selection){0, 0};
+}
+
+static int clearText(TextRenderer *self)
+{
+    self->size = (Size){0, 0};
+    self->textlen = 0;
+    self->hblen = 0;
+    return 0;
+}
+
+int TextRenderer_setText(TextRenderer *self, const UniStr *text)
+{
+    if (!self->font) return -1;
+    unsigned len = UniStr_len(text);
+    if (!len) return clearText(self);
+    guessProperties(self, text);
+    self->hbscript = hb_buffer_get_script(self->hbbuffer);
+    self->hbdirection = hb_buffer_get_direction(self->hbbuffer);
+    shape(self);
+    takeGlyphs(self);
+    self->textlen = len;
+    layoutGlyphs(self);
+    return 0;
+}
+
+static unsigned clusterStart(const TextRenderer *self, unsigned i)
+{
+    while (i && self->hbglyphs[i].cluster == self->hbglyphs[i-1].cluster) --i;
+    return i;
+}
+
+static unsigned clusterEnd(const TextRenderer *self, unsigned i)
+{
+    uint32_t cluster = self->hbglyphs[i].cluster;
+    while (i < self->hblen && self->hbglyphs[i].cluster == cluster) ++i;
+    return i;
+}
+
+static int unsafeToBreak(const TextRenderer *self, unsigned i)
+{
+    return !!(hb_glyph_info_get_glyph_flags(self->hbglyphs + i)
+	    & HB_GLYPH_FLAG_UNSAFE_TO_BREAK);
+}
+
+int TextRenderer_editText(TextRenderer *self, const UniStr *text,
+	unsigned pos, unsigned removed, unsigned inserted)
+{
+    if (!self->font) return -1;
+    unsigned len = UniStr_len(text);
+    if (!len) return clearText(self);
+    if (!self->hblen || self->hbdirection != HB_DIRECTION_LTR
+	    || pos + removed > self->textlen
+	    || len != self->textlen - removed + inserted)
+    {
+	return TextRenderer_setText(self, text);
+    }
+    if (!removed && !inserted) return 0;
+
+    /* Changes of script or direction affect the whole text */
+    guessProperties(self, text);
+    if (hb_buffer_get_direction(self->hbbuffer) != self->hbdirection
+	    || hb_buffer_get_script(self->hbbuffer) != self->hbscript)
+    {
+	self->hbscript = hb_buffer_get_script(self->hbbuffer);
+	self->hbdirection = hb_buffer_get_direction(self->hbbuffer);
+	shape(self);
+	takeGlyphs(self);
+	self->textlen = len;
+	layoutGlyphs(self);
+	return 0;
+    }
+
+    /* Reshape from the cluster before the edit up to the cluster after
+     * it, widened to the nearest points where the old text was safe to
+     * break, so neighbouring glyphs can interact with the new text */
+    unsigned first = 0;
+    while (first < self->hblen && self->hbglyphs[first].cluster < pos)
+    {
+	++first;
+    }
+    if (first) first = clusterStart(self, first - 1);
+    while (first && unsafeToBreak(self, first))
+    {
+	first = clusterStart(self, first - 1);
+    }
+    unsigned last = first;
+    while (last < self->hblen
+	    && self->hbglyphs[last].cluster < pos + removed)
+    {
+	++last;
+    }
+    if (last < self->hblen) last = clusterEnd(self, last);
+    while (last < self->hblen && unsafeToBreak(self, last))
+    {
+	last = clusterEnd(self, last);
+    }
+    unsigned segstart = self->hbglyphs[first].cluster;
+    unsigned segend = last < self->hblen
+	? self->hbglyphs[last].cluster - removed + inserted : len;
+
+    hb_buffer_clear_contents(self->hbbuffer);
+    hb_buffer_add_codepoints(self->hbbuffer, UniStr_str(text), len,
+	    segstart, segend - segstart);
+    hb_buffer_set_direction(self->hbbuffer, self->hbdirection);
+    hb_buffer_set_script(self->hbbuffer, self->hbscript);
+    hb_buffer_set_language(self->hbbuffer, hb_language_from_string("en", -1));
+    shape(self);
+
+    unsigned seglen = hb_buffer_get_length(self->hbbuffer);
+    unsigned taillen = self->hblen - last;
+    unsigned newlen = first + seglen + taillen;
+    reserveGlyphs(self, newlen);
+    memmove(self->hbglyphs + first + seglen, self->hbglyphs + last,
+	    taillen * sizeof *self->hbglyphs);
+    memmove(self->hbpos + first + seglen, self->hbpos + last,
+	    taillen * sizeof *self->hbpos);
+    memcpy(self->hbglyphs + first,
+	    hb_buffer_get_glyph_infos(self->hbbuffer, 0),
+	    seglen * sizeof *self->hbglyphs);
+    memcpy(self->hbpos + first,
+	    hb_buffer_get_glyph_positions(self->hbbuffer, 0),
+	    seglen * sizeof *self->hbpos);
+    for (unsigned i = first + seglen; i < newlen; ++i)
+    {
+	self->hbglyphs[i].cluster = self->hbglyphs[i].cluster
+	    - removed + inserted;
+    }
+    self->hblen = newlen;
+    self->textlen = len;
+    layoutGlyphs(self);
     return 0;
 }
 
@@ -276,7 +444,7 @@ int TextRenderer_renderWithSelection(TextRenderer *self,
 	xcb_render_picture_t picture, Color color, Pos pos,
 	Selection selection, Color selectionColor)
 {
-    if (!self->hbbuffer) return -1;
+    if (!self->hblen) return -1;
     xcb_connection_t *c = X11Adapter_connection();
     xcb_render_picture_t ownerpic = Widget_picture(self->owner);
     if (!self->uploaded)
@@ -287,7 +455,7 @@ int TextRenderer_renderWithSelection(TextRenderer *self,
     xcb_render_picture_t srcpic;
     if (selection.len || Font_glyphtype(self->font) == FGT_BITMAP_BGRA)
     {
-	if (!self->tpic) createTmpPicture(self, c);
+	if (!self->tpicvalid) prepareTmpPicture(self, c);
 	if (selection.len &&
 		(memcmp(&selection, &self->selection, sizeof selection)
 		    || color != self->tcolor
@@ -376,6 +544,10 @@ void TextRenderer_destroy(TextRenderer *self)
 {
     if (!self) return;
     clearRenderer(self);
+    hb_buffer_destroy(self->hbbuffer);
+    free(self->glyphs);
+    free(self->hbpos);
+    free(self->hbglyphs);
     Pen_destroy(self->pen);
     free(self);
 }
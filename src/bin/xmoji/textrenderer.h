@@ -24,6 +24,9 @@ Font *TextRenderer_font(TextRenderer *self)
     CMETHOD;
 int TextRenderer_setText(TextRenderer *self, const UniStr *text)
     CMETHOD;
+int TextRenderer_editText(TextRenderer *self, const UniStr *text,
+	unsigned pos, unsigned removed, unsigned inserted)
+    CMETHOD;
 unsigned TextRenderer_nglyphs(const TextRenderer *self)
     CMETHOD;
 uint32_t TextRenderer_glyphIdAt(const TextRenderer *self, unsigned index)
@@ -1,17 +1,30 @@
+#define _POSIX_C_SOURCE 200112L
+
 #include "translator.h"
 
+#include "profile.h"
 #include "unistr.h"
 
 #include <poser/core.h>
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #ifdef WITH_NLS
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define XCTVERSION 1
+#define HEADERSZ 16
+#define ENTRYSZ 12
+#define NOENTRY 0xffffffffU
+
 typedef struct TranslationEntry
 {
-    void *str;
-    int type;
+    const void *str;
+    UniStr view;
 } TranslationEntry;
 #endif
 
@@ -21,16 +34,16 @@ struct Translator
 #ifdef WITH_NLS
     TranslationEntry *translations;
     unsigned translationslen;
+    void *map;
+    size_t mapsz;
 #endif
 };
 
 #ifdef WITH_NLS
-static int read32le(unsigned *val, FILE *in)
+static unsigned get32le(const unsigned char *data)
 {
-    unsigned char data[4];
-    if (fread(data, 4, 1, in) != 1) return -1;
-    *val = data[0] + (data[1] << 8) + (data[2] << 16) + (data[3] << 24);
-    return 0;
+    return data[0] + (data[1] << 8) + (data[2] << 16)
+	+ ((unsigned)data[3] << 24);
 }
 
 static char *xctname(const char *name, const char *lang)
@@ -50,55 +63,89 @@ static char *xctname(const char *name, const char *lang)
     return xctnm;
 }
 
+static void swap32(void *data, size_t len)
+{
+    unsigned char *b = data;
+    for (size_t i = 0; i < len; ++i, b += 4)
+    {
+	unsigned char tmp = b[0];
+	b[0] = b[3];
+	b[3] = tmp;
+	tmp = b[1];
+	b[1] = b[2];
+	b[2] = tmp;
+    }
+}
+
+/* The catalog is mapped into memory and used as is, the strings of
+ * translated entries are views into the mapping. Only on a host with
+ * different byte order, the UTF-32 strings are swapped in private copies
+ * of the pages. */
 static void loadTranslations(Translator *self,
 	const char *name, const char *lang)
 {
     self->translations = 0;
     self->translationslen = 0;
-    char *val = 0;
-    UniStr *us = 0;
+    self->map = 0;
+    self->mapsz = 0;
     char *xctnm = xctname(name, lang);
-    FILE *xct = fopen(xctnm, "rb");
-    if (!xct) goto done;
-    char magic[4];
-    if (fread(magic, 4, 1, xct) != 1) goto done;
-    unsigned len;
-    if (read32le(&len, xct) < 0) goto done;
+    int fd = open(xctnm, O_RDONLY);
+    free(xctnm);
+    if (fd < 0) return;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < HEADERSZ) goto done;
+    size_t sz = st.st_size;
+    unsigned char *map = mmap(0, sz, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) goto done;
+    self->map = map;
+    self->mapsz = sz;
+    if (memcmp(map, "XCT", 3) || map[3] != XCTVERSION) goto fail;
+    unsigned len = get32le(map + 4);
+    if ((sz - HEADERSZ) / ENTRYSZ < len) goto fail;
+    uint32_t bom;
+    memcpy(&bom, map + 8, sizeof bom);
+    if (bom != 0xfeffU && bom != 0xfffe0000U) goto fail;
+    int swapped = bom != 0xfeffU;
+    if (swapped && mprotect(map, sz, PROT_READ|PROT_WRITE) < 0) goto fail;
+
     self->translations = PSC_malloc(len * sizeof *self->translations);
     memset(self->translations, 0, len * sizeof *self->translations);
     self->translationslen = len;
     for (unsigned i = 0; i < len; ++i)
     {
-	signed char byte = fgetc(xct);
-	if (byte < 0) continue;
-	self->translations[i].type = byte;
-	unsigned slen;
-	if (read32le(&slen, xct) < 0) goto done;
-	val = PSC_malloc(slen+1);
-	if (fread(val, 1, slen, xct) < slen) goto done;
-	val[slen] = 0;
-	switch (byte)
+	const unsigned char *entry = map + HEADERSZ + (size_t)i * ENTRYSZ;
+	unsigned type = get32le(entry);
+	size_t slen = get32le(entry + 4);
+	size_t offset = get32le(entry + 8);
+	if (type == NOENTRY) continue;
+	size_t csz = type ? 4 : 1;
+	if (type > 1 || (offset & 3U) || offset > sz
+		|| (sz - offset) / csz <= slen) continue;
+	if (type == 0)
 	{
-	    case 0:
-		self->translations[i].str = val;
-		val = 0;
-		break;
-	    case 1:
-		us = UniStr_create(val);
-		self->translations[i].str = us;
-		free(val);
-		val = 0;
-		break;
-	    default:
-		self->translations[i].type = -1;
-		goto done;
+	    if (map[offset + slen]) continue;
+	    self->translations[i].str = map + offset;
+	    continue;
 	}
+	if (swapped) swap32(map + offset, slen + 1);
+	char32_t *str = (char32_t *)(void *)(map + offset);
+	if (str[slen]) continue;
+	self->translations[i].view = (UniStr){
+	    .len = slen,
+	    .str = str,
+	    .refcnt = -1
+	};
+	self->translations[i].str = &self->translations[i].view;
     }
+    if (swapped) mprotect(map, sz, PROT_READ);
+    goto done;
 
+fail:
+    munmap(map, sz);
+    self->map = 0;
+    self->mapsz = 0;
 done:
-    if (xct) fclose(xct);
-    free(val);
-    free(xctnm);
+    close(fd);
 }
 #endif
 
@@ -108,7 +155,9 @@ Translator *Translator_create(const char *name, const char *lang,
     Translator *self = PSC_malloc(sizeof *self);
     self->gettext = gettext;
 #ifdef WITH_NLS
+    int span = Profile_begin("Translator_create", name);
     loadTranslations(self, name, lang);
+    Profile_end(span);
 #else
     (void)name;
     (void)lang;
@@ -144,23 +193,22 @@ const void *Translator_getOriginal(const Translator *self, unsigned id)
     return self->gettext(id);
 }
 
+int Translator_hasTranslations(const Translator *self)
+{
+#ifdef WITH_NLS
+    return !!self->translations;
+#else
+    (void)self;
+    return 0;
+#endif
+}
+
 void Translator_destroy(Translator *self)
 {
 #ifdef WITH_NLS
     if (!self) return;
-    if (self->translations)
-    {
-	for (unsigned i = 0; i < self->translationslen; ++i)
-	{
-	    if (self->translations[i].type < 0) continue;
-	    if (self->translations[i].type == 1)
-	    {
-		UniStr_destroy(self->translations[i].str);
-	    }
-	    else free(self->translations[i].str);
-	}
-	free(self->translations);
-    }
+    free(self->translations);
+    if (self->map) munmap(self->map, self->mapsz);
 #endif
     free(self);
 }
@@ -18,6 +18,8 @@ const void *Translator_getTranslation(const Translator *self, unsigned id)
     CMETHOD;
 const void *Translator_getOriginal(const Translator *self, unsigned id)
     CMETHOD;
+int Translator_hasTranslations(const Translator *self)
+    CMETHOD ATTR_PURE;
 void Translator_destroy(Translator *self);
 
 #endif
@@ -4,6 +4,47 @@
 #include <stdlib.h>
 #include <string.h>
 
+static size_t utf8size(char32_t c)
+{
+    if (c < 0x80U) return 1;
+    if (c < 0x800U) return 2;
+    if (c < 0x10000U) return 3;
+    return 4;
+}
+
+static size_t encodeutf8(char *out, char32_t c)
+{
+    if (c < 0x80U)
+    {
+	*out = c;
+	return 1;
+    }
+    if (c > 0x10ffffU) c = 0xfffdU;
+    unsigned char b[] = {
+	c & 0xffU,
+	c >> 8 & 0xffU,
+	c >> 16 & 0xffU
+    };
+    size_t len = 0;
+    if (c < 0x800U)
+    {
+	out[len++] = 0xc0U | (b[1] << 2) | (b[0] >> 6);
+	goto follow2;
+    }
+    if (c < 0x10000U)
+    {
+	out[len++] = 0xe0U | (b[1] >> 4);
+	goto follow1;
+    }
+    out[len++] = 0xf0U | (b[2] >> 2);
+    out[len++] = 0x80U | ((b[2] << 4) & 0x3fU) | (b[1] >> 4);
+follow1:
+    out[len++] = 0x80U | ((b[1] << 2) & 0x3fU) | (b[0] >> 6);
+follow2:
+    out[len++] = 0x80U | (b[0] & 0x3fU);
+    return len;
+}
+
 static size_t toutf8(char **utf8, size_t pos,
 	const char32_t *utf32, size_t len)
 {
@@ -13,34 +54,7 @@ static size_t toutf8(char **utf8, size_t pos,
     *utf8 = PSC_realloc(*utf8, pos + utf8maxlen + 1);
     for (size_t i = 0; i < len; ++i)
     {
-	char32_t c = utf32[i];
-	if (c < 0x80U)
-	{
-	    (*utf8)[pos + utf8len++] = c;
-	    continue;
-	}
-	if (c > 0x10ffffU) c = 0xfffdU;
-	unsigned char b[] = {
-	    c & 0xffU,
-	    c >> 8 & 0xffU,
-	    c >> 16 & 0xffU
-	};
-	if (c < 0x800U)
-	{
-	    (*utf8)[pos + utf8len++] = 0xc0U | (b[1] << 2) | (b[0] >> 6);
-	    goto follow2;
-	}
-	if (c < 0x10000U)
-	{
-	    (*utf8)[pos + utf8len++] = 0xe0U | (b[1] >> 4);
-	    goto follow1;
-	}
-	(*utf8)[pos + utf8len++] = 0xf0U | (b[2] >> 2);
-	(*utf8)[pos + utf8len++] = 0x80U | ((b[2] << 4) & 0x3fU) | (b[1] >> 4);
-follow1:
-	(*utf8)[pos + utf8len++] = 0x80U | ((b[1] << 2) & 0x3fU) | (b[0] >> 6);
-follow2:
-	(*utf8)[pos + utf8len++] = 0x80U | (b[0] & 0x3fU);
+	utf8len += encodeutf8(*utf8 + pos + utf8len, utf32[i]);
     }
     *utf8 = PSC_realloc(*utf8, pos + utf8len + 1);
     (*utf8)[pos + utf8len] = 0;
@@ -339,6 +353,32 @@ char *UniStr_toUtf8(const UniStr *self, size_t *len)
     return utf8;
 }
 
+size_t UniStr_utf8len(const UniStr *self)
+{
+    size_t len = 0;
+    for (size_t i = 0; i < self->len; ++i)
+    {
+	char32_t c = self->str[i];
+	len += utf8size(c > 0x10ffffU ? 0xfffdU : c);
+    }
+    return len;
+}
+
+size_t UniStr_utf8Chunk(const UniStr *self, size_t *pos,
+	char *buf, size_t bufsz)
+{
+    size_t len = 0;
+    while (*pos < self->len)
+    {
+	char32_t c = self->str[*pos];
+	if (c > 0x10ffffU) c = 0xfffdU;
+	if (len + utf8size(c) > bufsz) break;
+	len += encodeutf8(buf + len, c);
+	++*pos;
+    }
+    return len;
+}
+
 size_t UniStr_utf32len(const char32_t *s)
 {
     const char32_t *endp;
@@ -354,7 +394,7 @@ int UniStr_equals(const UniStr *str, const UniStr *other)
     return !memcmp(str->str, other->str, str->len * sizeof *str->str);
 }
 
-static char32_t isolc(char32_t c)
+char32_t UniStr_isolc(char32_t c)
 {
     if ((c >= 0x41 && c <= 0x5a)
 	    || (c >= 0xc0 && c <= 0xd6)
@@ -375,8 +415,8 @@ int UniStr_containslc(const UniStr *big, const UniStr *little)
 	int equals = 1;
 	for (size_t j = 0; j < little->len; ++j)
 	{
-	    char32_t a = isolc(big->str[start+j]);
-	    char32_t b = isolc(little->str[j]);
+	    char32_t a = UniStr_isolc(big->str[start+j]);
+	    char32_t b = UniStr_isolc(little->str[j]);
 	    if (a != b)
 	    {
 		equals = 0;
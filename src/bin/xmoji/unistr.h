@@ -113,11 +113,17 @@ char *UniStr_utf8ToLatin1(const char *utf8);
 
 char *UniStr_toUtf8(const UniStr *str, size_t *len)
     ATTR_NONNULL((1));
+size_t UniStr_utf8len(const UniStr *str)
+    ATTR_NONNULL((1));
+size_t UniStr_utf8Chunk(const UniStr *str, size_t *pos,
+	char *buf, size_t bufsz)
+    ATTR_NONNULL((1)) ATTR_NONNULL((2)) ATTR_NONNULL((3));
 
 size_t UniStr_utf32len(const char32_t *s)
     ATTR_NONNULL((1));
 
 int UniStr_equals(const UniStr *str, const UniStr *other);
+char32_t UniStr_isolc(char32_t c) ATTR_CONST;
 int UniStr_containslc(const UniStr *big, const UniStr *little);
 
 #endif
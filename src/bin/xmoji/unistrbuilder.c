@@ -67,6 +67,72 @@ void UniStrBuilder_appendStr(UniStrBuilder *self, const char32_t *s)
     self->string.len += appendlen;
 }
 
+size_t UniStrBuilder_appendUtf8(UniStrBuilder *self,
+	const char *utf8, size_t len)
+{
+    const unsigned char *b = (const unsigned char *)utf8;
+    adjust(self, self->string.len + len);
+    char32_t *out = self->string.str + self->string.len;
+    size_t i = 0;
+    while (i < len)
+    {
+	if (b[i] < 0x80U)
+	{
+	    *out++ = b[i++];
+	    continue;
+	}
+	char32_t c = 0;
+	size_t f = 0;
+	if ((b[i] & 0xe0U) == 0xc0U)
+	{
+	    c = b[i] & 0x1fU;
+	    f = 1;
+	}
+	else if ((b[i] & 0xf0U) == 0xe0U)
+	{
+	    c = b[i] & 0xfU;
+	    f = 2;
+	}
+	else if ((b[i] & 0xf8U) == 0xf0U)
+	{
+	    c = b[i] & 0x7U;
+	    f = 3;
+	}
+	else
+	{
+	    *out++ = 0xfffdU;
+	    ++i;
+	    continue;
+	}
+	size_t j = i + 1;
+	for (; f && j < len; --f, ++j)
+	{
+	    if ((b[j] & 0xc0U) != 0x80U) break;
+	    c <<= 6;
+	    c |= (b[j] & 0x3fU);
+	}
+	// incomplete sequence at the end, keep it for the next call
+	if (f && j == len) break;
+	*out++ = f ? 0xfffdU : c;
+	i = j;
+    }
+    *out = 0;
+    self->string.len = out - self->string.str;
+    adjust(self, self->string.len);
+    return i;
+}
+
+void UniStrBuilder_appendLatin1(UniStrBuilder *self,
+	const char *latin1, size_t len)
+{
+    adjust(self, self->string.len + len);
+    for (size_t i = 0; i < len; ++i)
+    {
+	self->string.str[self->string.len++] = (unsigned char)latin1[i];
+    }
+    self->string.str[self->string.len] = 0;
+}
+
 void UniStrBuilder_insertChar(UniStrBuilder *self,
 	size_t pos, char32_t c)
 {
@@ -127,8 +193,9 @@ UniStr *UniStrBuilder_string(const UniStrBuilder *self)
     string->len = self->string.len;
     string->str = PSC_malloc((string->len + 1) * sizeof *string->str);
     string->refcnt = 1;
-    memcpy(string->str, self->string.str,
+    if (self->string.str) memcpy(string->str, self->string.str,
 	    (string->len + 1) * sizeof *string->str);
+    else *string->str = 0;
     return string;
 }
 
@@ -16,6 +16,12 @@ void UniStrBuilder_appendChar(UniStrBuilder *self, char32_t c)
     CMETHOD;
 void UniStrBuilder_appendStr(UniStrBuilder *self, const char32_t *s)
     CMETHOD ATTR_NONNULL((2));
+size_t UniStrBuilder_appendUtf8(UniStrBuilder *self,
+	const char *utf8, size_t len)
+    CMETHOD ATTR_NONNULL((2));
+void UniStrBuilder_appendLatin1(UniStrBuilder *self,
+	const char *latin1, size_t len)
+    CMETHOD ATTR_NONNULL((2));
 
 void UniStrBuilder_insertChar(UniStrBuilder *self,
 	size_t pos, char32_t c)
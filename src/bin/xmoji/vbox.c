@@ -40,7 +40,7 @@ static void destroy(void *obj)
 {
     VBox *self = obj;
     PSC_List_destroy(self->items);
-    free(self);
+    Object_free(self);
 }
 
 static void destroyItem(void *obj)
@@ -282,7 +282,7 @@ static void sizeRequested(void *receiver, void *sender, void *args)
 
 VBox *VBox_createBase(void *derived, void *parent)
 {
-    VBox *self = PSC_malloc(sizeof *self);
+    VBox *self = NEWOBJ(sizeof *self);
     CREATEBASE(Widget, 0, parent);
     self->items = PSC_List_create();
     self->minSize = (Size){0, 0};
@@ -78,7 +78,7 @@ static void destroy(void *obj)
     Tooltip_destroy(self->tooltip);
     Object_destroy(self->menu);
     Font_destroy(self->font);
-    free(self);
+    Object_free(self);
 }
 
 static int doshow(Widget *self, int external)
@@ -134,7 +134,7 @@ static void requestError(void *receiver, void *sender, void *args)
 
 Widget *Widget_createBase(void *derived, const char *name, void *parent)
 {
-    Widget *self = PSC_malloc(sizeof *self);
+    Widget *self = NEWOBJ(sizeof *self);
     memset(self, 0, sizeof *self);
     CREATEBASE(Object);
     self->name = name;
@@ -1007,25 +1007,37 @@ void Widget_requestPaste(void *self, XSelectionName name, XSelectionType type)
 	    Object_instance(self), selectionReceived);
 }
 
-void Widget_setSelection(void *self, XSelectionName name,
-	XSelectionContent content)
+static XSelection *ownSelection(void *self, XSelectionName name)
 {
     Window *win = Window_fromWidget(self);
-    if (!win) return;
+    if (!win) return 0;
     Widget *parent = 0;
     Window *pwin = 0;
     while ((parent = ((Widget *)Object_instance(win))->container)
 	    && (pwin = Window_fromWidget(parent))) win = pwin;
-    XSelection *selection;
     switch (name)
     {
-	case XSN_PRIMARY:   selection = Window_primary(win); break;
-	case XSN_CLIPBOARD: selection = Window_clipboard(win); break;
-	default:	    return;
+	case XSN_PRIMARY:   return Window_primary(win);
+	case XSN_CLIPBOARD: return Window_clipboard(win);
+	default:	    return 0;
     }
+}
+
+void Widget_setSelection(void *self, XSelectionName name,
+	XSelectionContent content)
+{
+    XSelection *selection = ownSelection(self, name);
+    if (!selection) return;
     XSelection_publish(selection, Object_instance(self), content);
 }
 
+void Widget_releaseSelection(void *self, XSelectionName name)
+{
+    XSelection *selection = ownSelection(self, name);
+    if (!selection) return;
+    XSelection_release(selection, Object_instance(self));
+}
+
 void Widget_raisePasted(void *self, XSelectionName name,
 	XSelectionContent content)
 {
@@ -206,6 +206,7 @@ void Widget_requestPaste(void *self, XSelectionName name,
 	XSelectionType type) CMETHOD;
 void Widget_setSelection(void *self, XSelectionName name,
 	XSelectionContent content) CMETHOD;
+void Widget_releaseSelection(void *self, XSelectionName name) CMETHOD;
 void Widget_raisePasted(void *self, XSelectionName name,
 	XSelectionContent content) CMETHOD;
 const Rect *Widget_damages(const void *self, int *num) CMETHOD;
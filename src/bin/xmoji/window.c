@@ -1,19 +1,27 @@
+#define _POSIX_C_SOURCE 200112L
+
 #include "window.h"
 
 #include "font.h"
+#include "profile.h"
 #include "unistr.h"
 #include "x11adapter.h"
 #include "x11app-int.h"
 #include "xrdb.h"
 #include "xselection.h"
 
+#include <inttypes.h>
 #include <poser/core.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <xcb/present.h>
 #include <xkbcommon/xkbcommon-compose.h>
 
 #define DBLCLICK_MS 300
 #define MAXDAMAGES 16
+#define PRESENTTIMEOUT 4
 
 static void destroy(void *obj);
 static void expose(void *obj, Rect region);
@@ -29,6 +37,15 @@ static MetaWindow mo = MetaWindow_init(expose, draw, show, hide,
 	unselect, setFont, 0, 0, 0, clicked, 0,
 	"Window", destroy);
 
+typedef struct FrameStats
+{
+    unsigned long frames;	/* frames actually drawn */
+    unsigned long coalesced;	/* update passes merged into a later frame */
+    unsigned lastDrawUs;	/* time spent drawing the last frame */
+    unsigned avgDrawUs;		/* moving average of drawing time */
+    unsigned maxDrawUs;		/* longest drawing time */
+} FrameStats;
+
 struct Window
 {
     Object base;
@@ -43,6 +60,9 @@ struct Window
     void *focusWidget;
     void *hoverWidget;
     Window *tooltipWindow;
+    PSC_Timer *frameTimer;
+    FrameStats frameStats;
+    uint64_t msc;
     WindowFlags flags;
     Pos absMouse;
     Pos mouse;
@@ -61,6 +81,10 @@ struct Window
     xcb_render_picture_t dst;
     xcb_timestamp_t clicktime;
     uint32_t borderpixel;
+    uint32_t presentEid;
+    uint32_t frameSerial;
+    unsigned frameMs;
+    int framePending;
     int haveMinSize;
     int mapped;
     int wantmap;
@@ -153,6 +177,7 @@ static void map(Window *self)
     CHECK(xcb_map_window(c, self->w),
 	    "Cannot map window 0x%x", (unsigned)self->w);
     self->mapped = 1;
+    Profile_mark("map window");
     PSC_Log_fmt(PSC_L_DEBUG, "Mapping window 0x%x", (unsigned)self->w);
 }
 
@@ -581,12 +606,119 @@ static void requestError(void *receiver, void *sender, void *args)
     X11App_raiseError(xapp, self, widget, args);
 }
 
+static uint64_t nowus(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000U + ts.tv_nsec / 1000U;
+}
+
+static int needsupdate(Window *self)
+{
+    int ndamages;
+    Widget_damages(self, &ndamages);
+    if (ndamages || self->ndamages) return 1;
+    if (self->newSize.width && self->newSize.height) return 1;
+    return !!memcmp(&self->mouse, &self->mouseUpdate, sizeof self->mouse);
+}
+
+static void presentError(void *obj, unsigned sequence,
+	void *reply, xcb_generic_error_t *error)
+{
+    (void)sequence;
+    (void)reply;
+
+    Window *self = obj;
+    if (!error || !self->presentEid) return;
+    PSC_Log_fmt(PSC_L_WARNING, "Present notification failed for 0x%x, "
+	    "falling back to timed frames", (unsigned)self->w);
+    self->presentEid = 0;
+    PSC_Timer_setMs(self->frameTimer, self->frameMs);
+}
+
+static void startframe(Window *self)
+{
+    self->framePending = 1;
+    if (self->presentEid)
+    {
+	/* Ask for a notification at the next vertical blank. Without a known
+	 * MSC yet, divisor 1 makes the server pick the next possible one. */
+	CHECK(xcb_present_notify_msc(X11Adapter_connection(), self->w,
+		    ++self->frameSerial, self->msc ? self->msc + 1 : 0,
+		    !self->msc, 0),
+		self, presentError);
+    }
+    PSC_Timer_start(self->frameTimer, 0);
+}
+
+static void endframe(Window *self)
+{
+    if (!self->framePending) return;
+    self->framePending = 0;
+    PSC_Timer_stop(self->frameTimer);
+}
+
+static void frameexpired(void *receiver, void *sender, void *args)
+{
+    (void)sender;
+    (void)args;
+
+    Window *self = receiver;
+
+    /* With Present, this is just a timeout, the MSC might be stale */
+    self->msc = 0;
+    endframe(self);
+}
+
+static void presentCompleted(void *receiver, void *sender, void *args)
+{
+    (void)sender;
+
+    Window *self = receiver;
+    xcb_present_complete_notify_event_t *ev = args;
+    if (ev->kind != XCB_PRESENT_COMPLETE_KIND_NOTIFY_MSC
+	    || ev->serial != self->frameSerial) return;
+    self->msc = ev->msc;
+    endframe(self);
+}
+
+static void drawbenchmark(Window *self, unsigned runs)
+{
+    uint64_t total = 0;
+    uint64_t min = (uint64_t)-1;
+    uint64_t max = 0;
+    for (unsigned i = 0; i < runs; ++i)
+    {
+	Widget_invalidate(self);
+	uint64_t start = nowus();
+	Widget_draw(self);
+	uint64_t us = nowus() - start;
+	total += us;
+	if (us < min) min = us;
+	if (us > max) max = us;
+    }
+    fprintf(stderr, "Draw benchmark, %u full redraws of `%s': "
+	    "avg %.1f us, min %"PRIu64" us, max %"PRIu64" us\n", runs,
+	    Widget_resname(self), (double)total / runs, min, max);
+}
+
 static void doupdates(void *receiver, void *sender, void *args)
 {
     (void)sender;
     (void)args;
 
     Window *self = receiver;
+
+    /* Draw at most once per frame, updates arriving meanwhile are collected
+     * and handled together when the frame completed. */
+    if (self->framePending)
+    {
+	if (needsupdate(self)) ++self->frameStats.coalesced;
+	return;
+    }
+    int isframe = self->frameMs && self->mapped && needsupdate(self);
+    uint64_t framestart = isframe ? nowus() : 0;
+
     if (self->newSize.width && self->newSize.height)
     {
 	Size oldsz = Widget_size(self);
@@ -657,7 +789,31 @@ static void doupdates(void *receiver, void *sender, void *args)
 	}
     }
 done:
-    Widget_draw(self);
+    if (self->mapped && Profile_active())
+    {
+	int span = Profile_begin("first paint", Widget_resname(self));
+	Widget_draw(self);
+	Profile_end(span);
+	Profile_finish();
+	unsigned runs = Profile_benchmarkRuns();
+	if (runs) drawbenchmark(self, runs);
+    }
+    else Widget_draw(self);
+    if (isframe)
+    {
+	uint64_t drawus = nowus() - framestart;
+	if (drawus > (unsigned)-1) drawus = (unsigned)-1;
+	FrameStats *stats = &self->frameStats;
+	stats->lastDrawUs = drawus;
+	if (stats->maxDrawUs < stats->lastDrawUs)
+	{
+	    stats->maxDrawUs = stats->lastDrawUs;
+	}
+	stats->avgDrawUs = stats->frames++
+	    ? (7 * (uint64_t)stats->avgDrawUs + stats->lastDrawUs) / 8
+	    : stats->lastDrawUs;
+	startframe(self);
+    }
 }
 
 static void sizeChanged(void *receiver, void *sender, void *args)
@@ -761,6 +917,7 @@ static void mapped(void *receiver, void *sender, void *args)
 
     Window *self = receiver;
     self->mapped = 1;
+    Profile_mark("window mapped");
     X11App_addWindow(app(), self);
     PSC_Log_fmt(PSC_L_DEBUG, "Window 0x%x mapped", (unsigned)self->w);
 }
@@ -772,6 +929,7 @@ static void unmapped(void *receiver, void *sender, void *args)
 
     Window *self = receiver;
     self->mapped = 0;
+    endframe(self);
     Widget_hideWindow(self);
     PSC_Log_fmt(PSC_L_DEBUG, "Window 0x%x unmapped", (unsigned)self->w);
     if (!self->havewmstate && self->wantmap < 0)
@@ -785,8 +943,15 @@ static void unmapped(void *receiver, void *sender, void *args)
 static void destroy(void *window)
 {
     Window *self = window;
+    PSC_Log_fmt(PSC_L_DEBUG, "Window 0x%x: %lu frames, %lu updates "
+	    "coalesced, drawing avg %uus, max %uus", (unsigned)self->w,
+	    self->frameStats.frames, self->frameStats.coalesced,
+	    self->frameStats.avgDrawUs, self->frameStats.maxDrawUs);
     Object_destroy(self->tooltipWindow);
+    PSC_Timer_destroy(self->frameTimer);
     PSC_Event_unregister(Widget_sizeChanged(self), self, sizeChanged, 0);
+    PSC_Event_unregister(X11Adapter_presentComplete(), self,
+	    presentCompleted, self->w);
     PSC_Event_unregister(X11Adapter_eventsDone(), self, doupdates, 0);
     PSC_Event_unregister(X11Adapter_unmapNotify(), self,
 	    unmapped, self->w);
@@ -835,7 +1000,7 @@ static void destroy(void *window)
     xcb_destroy_window(c, self->w);
     free(self->iconName);
     free(self->title);
-    free(self);
+    Object_free(self);
 }
 
 
@@ -843,7 +1008,7 @@ Window *Window_createBase(void *derived, const char *name,
 	WindowFlags flags, void *parent)
 {
     WindowFlags wtype = flags & WF_WINDOW_TYPE;
-    Window *self = PSC_malloc(sizeof *self);
+    Window *self = NEWOBJ(sizeof *self);
     memset(self, 0, sizeof *self);
     void *owner = parent;
     if (wtype == WF_WINDOW_TOOLTIP) owner = 0;
@@ -994,6 +1159,26 @@ Window *Window_createBase(void *derived, const char *name,
 	}
     }
 
+    unsigned frameRate = XRdb_int(X11Adapter_resources(),
+	    XRdbKey(Widget_resname(self), "frameRate"),
+	    XRQF_OVERRIDES, 60, 0, 240);
+    if (frameRate)
+    {
+	self->frameMs = (1000 + frameRate / 2) / frameRate;
+	self->frameTimer = PSC_Timer_create();
+	PSC_Event_register(PSC_Timer_expired(self->frameTimer), self,
+		frameexpired, 0);
+	if (X11Adapter_hasPresent())
+	{
+	    self->presentEid = xcb_generate_id(c);
+	    CHECK(xcb_present_select_input(c, self->presentEid, self->w,
+			XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY),
+		    self, presentError);
+	    PSC_Timer_setMs(self->frameTimer, PRESENTTIMEOUT * self->frameMs);
+	}
+	else PSC_Timer_setMs(self->frameTimer, self->frameMs);
+    }
+
     self->flags = flags;
     self->borderpixel = (uint32_t)-1;
 
@@ -1028,6 +1213,8 @@ Window *Window_createBase(void *derived, const char *name,
 	    propertyNotify, self->w);
     PSC_Event_register(X11Adapter_unmapNotify(), self,
 	    unmapped, self->w);
+    PSC_Event_register(X11Adapter_presentComplete(), self,
+	    presentCompleted, self->w);
     PSC_Event_register(X11Adapter_eventsDone(), self,
 	    doupdates, 0);
     PSC_Event_register(Widget_sizeChanged(self), self,
@@ -1427,3 +1614,41 @@ void Window_expose(void *self)
 		A(_NET_CURRENT_DESKTOP), XCB_ATOM_CARDINAL, 0, 1),
 	    self, exposeCheckDesktop);
 }
+
+static void exposeAtPointer(void *obj, unsigned sequence,
+	void *reply, xcb_generic_error_t *error)
+{
+    (void)sequence;
+
+    Window *self = obj;
+    if (!error && reply)
+    {
+	xcb_query_pointer_reply_t *pointer = reply;
+	xcb_screen_t *s = X11Adapter_screen();
+	Size size = Widget_size(self);
+	int32_t x = pointer->root_x - size.width / 2;
+	int32_t y = pointer->root_y - size.height / 2;
+	if (x + size.width > s->width_in_pixels)
+	{
+	    x = s->width_in_pixels - size.width;
+	}
+	if (y + size.height > s->height_in_pixels)
+	{
+	    y = s->height_in_pixels - size.height;
+	}
+	if (x < 0) x = 0;
+	if (y < 0) y = 0;
+	CHECK(xcb_configure_window(X11Adapter_connection(), self->w,
+		    XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y,
+		    (uint32_t[]){x, y}),
+		"Cannot move window 0x%x", (unsigned)self->w);
+    }
+    Window_expose(self);
+}
+
+void Window_exposeAtPointer(void *self)
+{
+    Window *w = Object_instance(self);
+    AWAIT(xcb_query_pointer(X11Adapter_connection(),
+		X11Adapter_screen()->root), w, exposeAtPointer);
+}
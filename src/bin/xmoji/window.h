@@ -118,4 +118,7 @@ void Window_raise(void *self, int force)
 void Window_expose(void *self)
     CMETHOD;
 
+void Window_exposeAtPointer(void *self)
+    CMETHOD;
+
 #endif
@@ -1,24 +1,33 @@
+#define _POSIX_C_SOURCE 200112L
+
 #include "x11adapter.h"
 
 #include "font.h"
+#include "profile.h"
 #include "suppress.h"
 #include "unistr.h"
+#include "x11stats.h"
 #include "xrdb.h"
 
+#include <errno.h>
 #include <inttypes.h>
 #include <poser/core.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <xcb/xcb_cursor.h>
 #include <xcb/xcb_image.h>
 #include <xcb/xcbext.h>
+#include <xcb/present.h>
 SUPPRESS(pedantic)
 #include <xcb/xkb.h>
 ENDSUPPRESS
 #include <xkbcommon/xkbcommon-compose.h>
 #include <xkbcommon/xkbcommon-x11.h>
 
-#define MAXWAITING 16384
+#define MINWAITING 1024
+#define MAXWAITING (1U << 20)
 #define SYNCTHRESH 8192
 #define MAXCOLORS 64
 
@@ -34,8 +43,10 @@ typedef struct X11ReplyHandlerRecord
     void *ctx;
     const char *sarg;
     xcb_generic_error_t *err;
-#ifdef TRACE_X11_REQUESTS
+    X11RequestStats *stats;
+    uint64_t queued;
     const char *reqsource;
+#ifdef TRACE_X11_REQUESTS
     const char *sourcefile;
     const char *function;
     unsigned lineno;
@@ -152,6 +163,8 @@ static PSC_Event *selectionClear;
 static PSC_Event *selectionNotify;
 static PSC_Event *selectionRequest;
 static PSC_Event *unmapNotify;
+static PSC_Event *presentComplete;
+static PSC_Event *keymapChanged;
 static PSC_Event *requestError;
 static PSC_Event *eventsDone;
 static xcb_atom_t atoms[NATOMS];
@@ -160,9 +173,12 @@ static xcb_render_pictformat_t formats[3];
 static int32_t kbdid;
 static int fd;
 static uint8_t xkbevbase;
+static uint8_t presentopcode;
 static int modmap[NUMMODS];
 
-static X11ReplyHandlerRecord waitingReplies[MAXWAITING];
+static X11ReplyHandlerRecord *waitingReplies;
+static unsigned *waitingIndex;
+static unsigned waitingSize;
 static unsigned waitingFront;
 static unsigned waitingBack;
 static unsigned waitingNum;
@@ -172,26 +188,65 @@ static int waitingNoreply;
 
 static ColorMapEntry colorMap[MAXCOLORS];
 
+static void indexWaiting(unsigned pos)
+{
+    /* Direct-mapped index from sequence number to queue position. It has
+     * twice the size of the queue, so entries only collide when requests
+     * without tracking create large gaps in the sequence numbers. */
+    waitingIndex[waitingReplies[pos].sequence & ((waitingSize << 1) - 1)]
+	= pos;
+}
+
+static int growWaiting(void)
+{
+    if (waitingSize == MAXWAITING) return -1;
+    unsigned newSize = waitingSize ? waitingSize << 1 : MINWAITING;
+    X11ReplyHandlerRecord *replies = PSC_malloc(
+	    newSize * sizeof *replies);
+    for (unsigned i = 0; i < waitingNum; ++i)
+    {
+	replies[i] = waitingReplies[(waitingFront + i) & (waitingSize - 1)];
+    }
+    free(waitingReplies);
+    free(waitingIndex);
+    waitingReplies = replies;
+    waitingIndex = PSC_malloc((newSize << 1) * sizeof *waitingIndex);
+    /* All bits set is never a valid position */
+    memset(waitingIndex, 0xff, (newSize << 1) * sizeof *waitingIndex);
+    waitingSize = newSize;
+    waitingFront = 0;
+    waitingBack = waitingNum;
+    for (unsigned i = 0; i < waitingNum; ++i) indexWaiting(i);
+    if (waitingSize > MINWAITING)
+    {
+	PSC_Log_fmt(PSC_L_DEBUG, "Reply queue grown to %u entries",
+		waitingSize);
+    }
+    return 0;
+}
+
 static int enqueueWaiting(X11RequestId reqid, int replytype, void *ctx,
 	X11ReplyHandler handler, const char *sarg, unsigned uarg)
 {
-    if (waitingNum == MAXWAITING) return -1;
-    waitingReplies[waitingBack].handler = handler;
-    waitingReplies[waitingBack].ctx = ctx;
-    waitingReplies[waitingBack].sarg = sarg;
-    waitingReplies[waitingBack].err = 0;
+    if (waitingNum == waitingSize && growWaiting() < 0) return -1;
+    X11ReplyHandlerRecord *rec = waitingReplies + waitingBack;
+    rec->handler = handler;
+    rec->ctx = ctx;
+    rec->sarg = sarg;
+    rec->err = 0;
+    rec->stats = X11Stats_request(reqid.reqsource, waitingNum + 1);
+    rec->queued = rec->stats ? X11Stats_now() : 0;
+    rec->reqsource = reqid.reqsource;
 #ifdef TRACE_X11_REQUESTS
-    waitingReplies[waitingBack].reqsource = reqid.reqsource;
-    waitingReplies[waitingBack].sourcefile = reqid.sourcefile;
-    waitingReplies[waitingBack].function = reqid.function;
-    waitingReplies[waitingBack].lineno = reqid.lineno;
-    waitingReplies[waitingBack].sequence = reqid.sequence;
-#else
-    waitingReplies[waitingBack].sequence = reqid;
+    rec->sourcefile = reqid.sourcefile;
+    rec->function = reqid.function;
+    rec->lineno = reqid.lineno;
 #endif
-    waitingReplies[waitingBack].replytype = replytype;
-    waitingReplies[waitingBack].uarg = uarg;
-    if (++waitingBack == MAXWAITING) waitingBack = 0;
+    rec->sequence = reqid.sequence;
+    rec->replytype = replytype;
+    rec->uarg = uarg;
+    indexWaiting(waitingBack);
+    waitingBack = (waitingBack + 1) & (waitingSize - 1);
     ++waitingNum;
     ++newWaiting;
     if (replytype == RQ_AWAIT_NOREPLY) waitingNoreply = 1;
@@ -203,19 +258,34 @@ static void removeFirstWaiting(void)
 {
     if (!waitingNum) return;
     --waitingNum;
-    if (++waitingFront == MAXWAITING) waitingFront = 0;
+    waitingFront = (waitingFront + 1) & (waitingSize - 1);
 }
 
 static X11ReplyHandlerRecord *findWaitingBySequence(unsigned sequence)
 {
     if (!waitingNum) return 0;
-    unsigned i = waitingFront;
-    do
+    unsigned pos = waitingIndex[sequence & ((waitingSize << 1) - 1)];
+    if (pos < waitingSize
+	    && ((pos - waitingFront) & (waitingSize - 1)) < waitingNum
+	    && waitingReplies[pos].sequence == sequence)
+    {
+	return waitingReplies + pos;
+    }
+
+    /* Index entry was overwritten or the request isn't tracked, fall back
+     * to binary search, sequence numbers are ascending in the queue */
+    unsigned lo = 0;
+    unsigned hi = waitingNum;
+    while (lo < hi)
     {
-	if (waitingReplies[i].sequence == sequence) return waitingReplies + i;
-	if ((int)(waitingReplies[i].sequence - sequence) > 0) return 0;
-	if (++i == MAXWAITING) i = 0;
-    } while (i != waitingBack);
+	unsigned mid = lo + ((hi - lo) >> 1);
+	X11ReplyHandlerRecord *rec = waitingReplies
+	    + ((waitingFront + mid) & (waitingSize - 1));
+	int diff = (int)(rec->sequence - sequence);
+	if (!diff) return rec;
+	if (diff < 0) lo = mid + 1;
+	else hi = mid;
+    }
     return 0;
 }
 
@@ -257,11 +327,16 @@ static void handleXkbEvent(XkbEvent *ev)
     {
 	case XCB_XKB_NEW_KEYBOARD_NOTIFY:
 	    if (((xcb_xkb_new_keyboard_notify_event_t *)ev)->changed
-		    & XCB_XKB_NKN_DETAIL_KEYCODES) updateKeymap();
+		    & XCB_XKB_NKN_DETAIL_KEYCODES)
+	    {
+		updateKeymap();
+		PSC_Event_raise(keymapChanged, 0, 0);
+	    }
 	    break;
 
 	case XCB_XKB_MAP_NOTIFY:
 	    updateKeymap();
+	    PSC_Event_raise(keymapChanged, 0, ev);
 	    break;
 
 	case XCB_XKB_STATE_NOTIFY:
@@ -279,6 +354,7 @@ static void handleXkbEvent(XkbEvent *ev)
 static void handleX11Reply(X11ReplyHandlerRecord *rec, void *reply,
 	xcb_generic_error_t *error)
 {
+    X11Stats_completed(rec->stats, rec->queued, !!error);
     if (reply)
     {
 	if (rec->replytype != RQ_AWAIT_REPLY)
@@ -306,17 +382,15 @@ static void handleX11Reply(X11ReplyHandlerRecord *rec, void *reply,
 	    case RQ_CHECK_ERROR_UNSIGNED:
 		PSC_Log_fmt(PSC_L_ERROR, rec->ctx, rec->uarg);
 		RequestErrorEventArgs ea = {
-#ifdef TRACE_X11_REQUESTS
 		    .reqid = {
 			.reqsource = rec->reqsource,
+#ifdef TRACE_X11_REQUESTS
 			.sourcefile = rec->sourcefile,
 			.function = rec->function,
 			.lineno = rec->lineno,
+#endif
 			.sequence = rec->sequence
 		    },
-#else
-		    .reqid = rec->sequence,
-#endif
 		    .opMinor = error->minor_code,
 		    .opMajor = error->major_code,
 		    .code = error->error_code
@@ -344,13 +418,13 @@ static void handleX11Event(xcb_generic_event_t *ev)
     if (ev->response_type == 0)
     {
 	// Try to match the error to an outstanding request
-	X11ReplyHandlerRecord *rec = findWaitingBySequence(ev->sequence);
+	X11ReplyHandlerRecord *rec = findWaitingBySequence(ev->full_sequence);
 	if (rec)
 	{
 	    if (rec->err)
 	    {
 		PSC_Log_fmt(PSC_L_ERROR, "Received second error for %u",
-			ev->sequence);
+			ev->full_sequence);
 		free(rec->err);
 	    }
 	    rec->err = (xcb_generic_error_t *)ev;
@@ -361,7 +435,7 @@ static void handleX11Event(xcb_generic_event_t *ev)
 	    // Received an error that couldn't be matched to a request
 	    PSC_Log_fmt(PSC_L_WARNING, "Unhandled X11 error %d: %u",
 		    ((xcb_generic_error_t *)ev)->error_code,
-		    ev->sequence);
+		    ev->full_sequence);
 	}
     }
 
@@ -370,6 +444,17 @@ static void handleX11Event(xcb_generic_event_t *ev)
 	handleXkbEvent((XkbEvent *)ev);
     }
 
+    else if (presentopcode && ev->response_type == XCB_GE_GENERIC
+	    && ((xcb_ge_generic_event_t *)ev)->extension == presentopcode)
+    {
+	xcb_present_generic_event_t *pev = (xcb_present_generic_event_t *)ev;
+	if (pev->evtype == XCB_PRESENT_EVENT_COMPLETE_NOTIFY)
+	{
+	    PSC_Event_raise(presentComplete,
+		    ((xcb_present_complete_notify_event_t *)ev)->window, ev);
+	}
+    }
+
     else switch (ev->response_type & 0x7f)
     {
 	case XCB_BUTTON_PRESS:
@@ -584,6 +669,18 @@ static void sync_cb(void *ctx, unsigned sequence,
     PSC_Log_msg(PSC_L_DEBUG, "X11 connection synced");
 }
 
+static void startSync(X11SyncReason reason)
+{
+    static int starting;
+
+    if (syncseq || starting) return;
+    starting = 1;
+    X11Stats_sync(reason);
+    syncseq = AWAIT(xcb_get_input_focus(c), 0, sync_cb);
+    xcb_flush(c);
+    starting = 0;
+}
+
 static void flushandsync(void *receiver, void *sender, void *args)
 {
     (void)receiver;
@@ -606,8 +703,7 @@ static void flushandsync(void *receiver, void *sender, void *args)
 	/* Finally check whether a sync is needed */
 	if (!syncseq && (waitingNoreply || waitingNum >= SYNCTHRESH))
 	{
-	    syncseq = AWAIT(xcb_get_input_focus(c), 0, sync_cb);
-	    xcb_flush(c);
+	    startSync(waitingNoreply ? X11SR_NOREPLY : X11SR_THRESHOLD);
 	}
 	else if (newWaiting)
 	{
@@ -691,11 +787,108 @@ static int probeGlyphRenderSourcePositionGlitch(void)
     return haveGlitch;
 }
 
+/* Results that only depend on the X server (vendor and release) and would
+ * cost round trips, like probing for glitches, are cached in the user's
+ * cache directory. */
+char *X11Adapter_cacheFile(const char *file, int create)
+{
+    const char *cachehome = getenv("XDG_CACHE_HOME");
+    const char *home = 0;
+    if (!cachehome || !*cachehome)
+    {
+	home = getenv("HOME");
+	if (!home || !*home) return 0;
+	cachehome = ".cache";
+    }
+    size_t homelen = home ? strlen(home) + 1 : 0;
+    size_t cachelen = strlen(cachehome);
+    char *name = PSC_malloc(homelen + cachelen + sizeof "/xmoji/"
+	    + strlen(file));
+    if (home)
+    {
+	memcpy(name, home, homelen - 1);
+	name[homelen - 1] = '/';
+    }
+    memcpy(name + homelen, cachehome, cachelen);
+    strcpy(name + homelen + cachelen, "/xmoji");
+    if (create)
+    {
+	char *sep = name + homelen + cachelen;
+	*sep = 0;
+	if (mkdir(name, 0777) < 0 && errno != EEXIST) goto fail;
+	*sep = '/';
+	if (mkdir(name, 0777) < 0 && errno != EEXIST) goto fail;
+    }
+    strcat(name, "/");
+    strcat(name, file);
+    return name;
+
+fail:
+    free(name);
+    return 0;
+}
+
+char *X11Adapter_serverKey(void)
+{
+    const xcb_setup_t *setup = xcb_get_setup(c);
+    int vendorlen = xcb_setup_vendor_length(setup);
+    char *key = PSC_malloc(vendorlen + 12);
+    sprintf(key, "%"PRIu32" ", setup->release_number);
+    size_t pos = strlen(key);
+    memcpy(key + pos, xcb_setup_vendor(setup), vendorlen);
+    key[pos + vendorlen] = 0;
+    for (char *p = key + pos; *p; ++p)
+    {
+	if (*p == '\n') *p = ' ';
+    }
+    return key;
+}
+
+static int readGlitchCache(const char *key, XGlitch *cached)
+{
+    char *name = X11Adapter_cacheFile("glitches", 0);
+    if (!name) return -1;
+    FILE *f = fopen(name, "r");
+    free(name);
+    if (!f) return -1;
+    int rc = -1;
+    char line[512];
+    while (fgets(line, sizeof line, f))
+    {
+	char *end;
+	unsigned long val = strtoul(line, &end, 16);
+	if (*end++ != ' ') continue;
+	end[strcspn(end, "\n")] = 0;
+	if (!strcmp(end, key))
+	{
+	    *cached = val;
+	    rc = 0;
+	}
+    }
+    fclose(f);
+    return rc;
+}
+
+static void writeGlitchCache(const char *key, XGlitch value)
+{
+    char *name = X11Adapter_cacheFile("glitches", 1);
+    if (!name) return;
+    FILE *f = fopen(name, "a");
+    if (f)
+    {
+	fprintf(f, "%x %s\n", (unsigned)value, key);
+	fclose(f);
+    }
+    else PSC_Log_fmt(PSC_L_WARNING, "Cannot write glitch cache `%s'", name);
+    free(name);
+}
+
 int X11Adapter_init(int argc, char **argv, const char *locale,
 	const char *name, const char *classname)
 {
     xcb_render_query_pict_formats_reply_t *pf = 0;
     if (c) return 0;
+    int span = Profile_begin("connect", 0);
     c = xcb_connect(0, 0);
     if (xcb_connection_has_error(c))
     {
@@ -704,21 +897,66 @@ int X11Adapter_init(int argc, char **argv, const char *locale,
 		"If you're in an X session, check your DISPLAY variable.");
 	goto error;
     }
+    Profile_end(span);
+
+    /* Send all requests not depending on each other's replies first and
+     * only then start collecting the replies, so startup doesn't pay for
+     * each round trip separately. This matters a lot on remote displays. */
+    span = Profile_begin("send requests", 0);
+    xcb_prefetch_extension_data(c, &xcb_render_id);
+    xcb_prefetch_extension_data(c, &xcb_present_id);
+    xcb_prefetch_extension_data(c, &xcb_xkb_id);
+    xcb_prefetch_maximum_request_length(c);
+    xcb_intern_atom_cookie_t atomcookies[NATOMS];
+    for (int i = 0; i < NATOMS; ++i)
+    {
+	atomcookies[i] = xcb_intern_atom(c, 0, atomnm[i].len, atomnm[i].nm);
+    }
 
+    /* Everything from here needs extension data, so the first request waits
+     * for the burst above */
     xcb_render_query_version_cookie_t versioncookie =
 	xcb_render_query_version(c,
 		XCB_RENDER_MAJOR_VERSION, XCB_RENDER_MINOR_VERSION);
-    xcb_intern_atom_cookie_t atomcookies[NATOMS];
-    for (int i = 0; i < NATOMS; ++i)
+    xcb_render_query_pict_formats_cookie_t formatscookie =
+	xcb_render_query_pict_formats(c);
+    const xcb_query_extension_reply_t *presentext =
+	xcb_get_extension_data(c, &xcb_present_id);
+    xcb_present_query_version_cookie_t presentcookie = { 0 };
+    if (presentext && presentext->present)
     {
-	atomcookies[i] = xcb_intern_atom(c, 0, atomnm[i].len, atomnm[i].nm);
+	presentcookie = xcb_present_query_version(c,
+		XCB_PRESENT_MAJOR_VERSION, XCB_PRESENT_MINOR_VERSION);
     }
+    const xcb_query_extension_reply_t *xkbext =
+	xcb_get_extension_data(c, &xcb_xkb_id);
+    if (!xkbext || !xkbext->present)
+    {
+	PSC_Log_msg(PSC_L_ERROR, "XKB extension not available");
+	goto error;
+    }
+    xkbevbase = xkbext->first_event;
+    xcb_xkb_use_extension_cookie_t xkbcookie = xcb_xkb_use_extension(c,
+	    XKB_X11_MIN_MAJOR_XKB_VERSION, XKB_X11_MIN_MINOR_XKB_VERSION);
+    xcb_xkb_get_device_info_cookie_t kbdcookie = xcb_xkb_get_device_info(c,
+	    XCB_XKB_ID_USE_CORE_KBD, 0, 0, 0, 0, 0, 0);
+    xcb_void_cookie_t xkbeventscookie = xcb_xkb_select_events_aux_checked(c,
+	    XCB_XKB_ID_USE_CORE_KBD, XKBEVENTS, 0, 0,
+	    XKBMAPPARTS, XKBMAPPARTS, &xkbevdetails);
+    s = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    maxRequestSize = xcb_get_maximum_request_length(c) << 2;
+    uint32_t maxproplen = (maxRequestSize
+	    - sizeof(xcb_get_property_reply_t)) >> 2;
+    xcb_get_property_cookie_t rescookie = xcb_get_property(c, 0, s->root,
+	    XCB_ATOM_RESOURCE_MANAGER, XCB_ATOM_STRING, 0, maxproplen);
+    xcb_flush(c);
+    Profile_end(span);
+
+    span = Profile_begin("receive replies", 0);
     xcb_render_query_version_reply_t *version =
 	xcb_render_query_version_reply(c, versioncookie, 0);
-    xcb_render_query_pict_formats_cookie_t formatscookie;
     if (version)
     {
-	formatscookie = xcb_render_query_pict_formats(c);
 	PSC_Log_fmt(PSC_L_INFO, "using XRender version %"PRIu32".%"PRIu32,
 		version->major_version, version->minor_version);
 	free(version);
@@ -746,12 +984,49 @@ int X11Adapter_init(int argc, char **argv, const char *locale,
 	PSC_Log_msg(PSC_L_ERROR, "Could not query picture formats");
 	goto error;
     }
+    if (presentcookie.sequence)
+    {
+	xcb_present_query_version_reply_t *presentversion =
+	    xcb_present_query_version_reply(c, presentcookie, 0);
+	if (presentversion)
+	{
+	    PSC_Log_fmt(PSC_L_INFO, "using Present version %"PRIu32".%"PRIu32,
+		    presentversion->major_version,
+		    presentversion->minor_version);
+	    presentopcode = presentext->major_opcode;
+	    free(presentversion);
+	}
+    }
+    if (!presentopcode)
+    {
+	PSC_Log_msg(PSC_L_INFO,
+		"Present extension not available, using timed frames");
+    }
+    xcb_xkb_use_extension_reply_t *xkbversion =
+	xcb_xkb_use_extension_reply(c, xkbcookie, 0);
+    if (!xkbversion || !xkbversion->supported)
+    {
+	PSC_Log_msg(PSC_L_ERROR, "Required XKB version not supported");
+	free(xkbversion);
+	goto error;
+    }
+    PSC_Log_fmt(PSC_L_INFO, "using XKB version %"PRIu16".%"PRIu16,
+	    xkbversion->serverMajor, xkbversion->serverMinor);
+    free(xkbversion);
+    xcb_xkb_get_device_info_reply_t *kbdinfo =
+	xcb_xkb_get_device_info_reply(c, kbdcookie, 0);
+    if (!kbdinfo)
+    {
+	PSC_Log_msg(PSC_L_ERROR, "No core keyboard found");
+	goto error;
+    }
+    kbdid = kbdinfo->deviceID;
+    free(kbdinfo);
+    Profile_end(span);
 
-    s = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
     dpi = (((double) s->height_in_pixels) * 25.4) /
 	((double) s->height_in_millimeters);
 
-    maxRequestSize = xcb_get_maximum_request_length(c) << 2;
     PSC_Log_fmt(PSC_L_DEBUG, "maximum request size is %zu bytes",
 	    maxRequestSize);
     xcb_render_pictscreen_iterator_t si =
@@ -844,33 +1119,27 @@ int X11Adapter_init(int argc, char **argv, const char *locale,
 	goto error;
     }
 
-    glitches = 0;
-    if (probeGlyphRenderSourcePositionGlitch())
+    span = Profile_begin("glitch probe", 0);
+    char *glitchkey = X11Adapter_serverKey();
+    if (readGlitchCache(glitchkey, &glitches) < 0)
+    {
+	glitches = 0;
+	if (probeGlyphRenderSourcePositionGlitch())
+	{
+	    glitches |= XG_RENDER_SRC_OFFSET;
+	}
+	writeGlitchCache(glitchkey, glitches);
+    }
+    else PSC_Log_msg(PSC_L_DEBUG, "Using cached glitch probe results");
+    free(glitchkey);
+    if (glitches & XG_RENDER_SRC_OFFSET)
     {
 	PSC_Log_msg(PSC_L_INFO,
 		"Detected glyph rendering glitch, enabling workaround.");
-	glitches |= XG_RENDER_SRC_OFFSET;
     }
+    Profile_end(span);
 
-    uint16_t xkbmaj;
-    uint16_t xkbmin;
-    if (xkb_x11_setup_xkb_extension(c, XKB_X11_MIN_MAJOR_XKB_VERSION,
-		XKB_X11_MIN_MINOR_XKB_VERSION,
-		XKB_X11_SETUP_XKB_EXTENSION_NO_FLAGS, &xkbmaj, &xkbmin,
-		&xkbevbase, 0))
-    {
-	PSC_Log_fmt(PSC_L_INFO, "using XKB version %"PRIu16".%"PRIu16,
-		xkbmaj, xkbmin);
-    }
-    else goto error;
-    kbdid = xkb_x11_get_core_keyboard_device_id(c);
-    if (kbdid == -1)
-    {
-	PSC_Log_msg(PSC_L_ERROR, "No core keyboard found");
-	goto error;
-    }
-    xcb_void_cookie_t xkbeventscookie = xcb_xkb_select_events_aux_checked(c,
-	    kbdid, XKBEVENTS, 0, 0, XKBMAPPARTS, XKBMAPPARTS, &xkbevdetails);
+    span = Profile_begin("XKB setup", 0);
     kbdctx = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
     if (!kbdctx)
     {
@@ -878,11 +1147,6 @@ int X11Adapter_init(int argc, char **argv, const char *locale,
 	goto error;
     }
 
-    uint32_t maxproplen = (maxRequestSize
-	    - sizeof(xcb_get_property_reply_t)) >> 2;
-    xcb_get_property_cookie_t rescookie = xcb_get_property(c, 0, s->root,
-	    XCB_ATOM_RESOURCE_MANAGER, XCB_ATOM_STRING, 0, maxproplen);
-
     kbdcompose = xkb_compose_table_new_from_locale(kbdctx, locale,
 	    XKB_COMPOSE_COMPILE_NO_FLAGS);
     if (!kbdcompose)
@@ -904,6 +1168,8 @@ int X11Adapter_init(int argc, char **argv, const char *locale,
     free(nm);
     wmclasssz = pos + len2 + 1;
     if (wmclasssz > sizeof wmclass) wmclasssz = sizeof wmclass;
+    Profile_end(span);
+    span = Profile_begin("resources", 0);
     xcb_generic_error_t *rqerr = xcb_request_check(c, xkbeventscookie);
     if (rqerr)
     {
@@ -958,7 +1224,9 @@ int X11Adapter_init(int argc, char **argv, const char *locale,
     if (resdpi) dpi = resdpi;
     PSC_Log_fmt(PSC_L_INFO, "Screen resolution%s: %.2f dpi",
 	    resdpi ? " (overridden)" : "", dpi);
+    Profile_end(span);
 
+    span = Profile_begin("cursors", 0);
     if (xcb_cursor_context_new(c, s, &cctx) < 0)
     {
 	PSC_Log_msg(PSC_L_ERROR, "Could not initialize XCursor");
@@ -968,6 +1236,7 @@ int X11Adapter_init(int argc, char **argv, const char *locale,
     {
 	cursors[i] = xcb_cursor_load_cursor(cctx, cursornames[i]);
     }
+    Profile_end(span);
 
     buttonpress = PSC_Event_create(0);
     buttonrelease = PSC_Event_create(0);
@@ -986,6 +1255,8 @@ int X11Adapter_init(int argc, char **argv, const char *locale,
     selectionNotify = PSC_Event_create(0);
     selectionRequest = PSC_Event_create(0);
     unmapNotify = PSC_Event_create(0);
+    presentComplete = PSC_Event_create(0);
+    keymapChanged = PSC_Event_create(0);
     requestError = PSC_Event_create(0);
     eventsDone = PSC_Event_create(0);
     fd = xcb_get_file_descriptor(c);
@@ -993,6 +1264,13 @@ int X11Adapter_init(int argc, char **argv, const char *locale,
     PSC_Event_register(PSC_Service_eventsDone(), 0, flushandsync, 0);
     PSC_Service_registerRead(fd);
 
+    int stats = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+	if (!strcmp(argv[i], "-stats")) stats = 1;
+    }
+    X11Stats_init(c, stats);
+
     updateKeymap();
 
     rdpos = xcb_total_read(c);
@@ -1055,6 +1333,12 @@ struct xkb_compose_table *X11Adapter_kbdcompose(void)
     return kbdcompose;
 }
 
+uint32_t X11Adapter_keyCodepoint(xcb_keycode_t keycode)
+{
+    if (!kbdstate) return 0;
+    return xkb_state_key_get_utf32(kbdstate, keycode);
+}
+
 PSC_Event *X11Adapter_buttonpress(void)
 {
     return buttonpress;
@@ -1140,6 +1424,21 @@ PSC_Event *X11Adapter_unmapNotify(void)
     return unmapNotify;
 }
 
+PSC_Event *X11Adapter_presentComplete(void)
+{
+    return presentComplete;
+}
+
+PSC_Event *X11Adapter_keymapChanged(void)
+{
+    return keymapChanged;
+}
+
+int X11Adapter_hasPresent(void)
+{
+    return !!presentopcode;
+}
+
 PSC_Event *X11Adapter_requestError(void)
 {
     return requestError;
@@ -1179,11 +1478,14 @@ static unsigned await(X11RequestId reqid, int replytype, void *ctx,
 	PSC_Log_msg(PSC_L_ERROR, "Reply queue is full");
 	PSC_Service_quit();
     }
-#ifdef TRACE_X11_REQUESTS
+    else if (waitingNum >= SYNCTHRESH)
+    {
+	/* Don't wait for the end of the event loop iteration when lots of
+	 * requests are queued in a burst, let the server start working on
+	 * them and make sure replies get processed soon. */
+	startSync(X11SR_THRESHOLD);
+    }
     return reqid.sequence;
-#else
-    return reqid;
-#endif
 }
 
 unsigned X11Adapter_await(X11RequestId reqid, void *ctx,
@@ -1328,15 +1630,23 @@ void X11Adapter_done(void)
     }
     if (npixels) xcb_free_colors(c, s->default_colormap, 0, npixels, pixels);
     memset(colorMap, 0, MAXCOLORS * sizeof *colorMap);
+    X11Stats_done();
     PSC_Service_unregisterRead(fd);
     PSC_Event_unregister(PSC_Service_eventsDone(), 0, flushandsync, 0);
     PSC_Event_unregister(PSC_Service_readyRead(), 0, readX11Input, fd);
     fd = 0;
+    free(waitingIndex);
+    free(waitingReplies);
+    waitingIndex = 0;
+    waitingReplies = 0;
+    waitingSize = 0;
     waitingFront = 0;
     waitingBack = 0;
     waitingNum = 0;
     PSC_Event_destroy(eventsDone);
     PSC_Event_destroy(requestError);
+    PSC_Event_destroy(keymapChanged);
+    PSC_Event_destroy(presentComplete);
     PSC_Event_destroy(unmapNotify);
     PSC_Event_destroy(selectionRequest);
     PSC_Event_destroy(selectionNotify);
@@ -1356,6 +1666,7 @@ void X11Adapter_done(void)
     PSC_Event_destroy(buttonpress);
     eventsDone = 0;
     requestError = 0;
+    presentComplete = 0;
     unmapNotify = 0;
     selectionRequest = 0;
     selectionClear = 0;
@@ -1392,6 +1703,7 @@ void X11Adapter_done(void)
     kbdctx = 0;
     xcb_disconnect(c);
     maxRequestSize = 0;
+    presentopcode = 0;
     dpi = 96.;
     s = 0;
     c = 0;
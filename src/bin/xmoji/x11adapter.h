@@ -162,15 +162,18 @@ typedef struct XkbKeyEventArgs
     XkbModifier rawmods;
 } XkbKeyEventArgs;
 
-#ifdef TRACE_X11_REQUESTS
 typedef struct X11RequestId
 {
     const char *reqsource;
+#ifdef TRACE_X11_REQUESTS
     const char *sourcefile;
     const char *function;
     unsigned lineno;
+#endif
     unsigned sequence;
 } X11RequestId;
+
+#ifdef TRACE_X11_REQUESTS
 #include <poser/core/log.h>
 #define priv_Trace(x,s) ( \
 	PSC_Log_fmt(PSC_L_DEBUG, __FILE__ ":" STR(__LINE__) \
@@ -182,8 +185,9 @@ typedef struct X11RequestId
 	    .lineno = __LINE__, \
 	    .sequence = (x).sequence })
 #else
-typedef unsigned X11RequestId;
-#define priv_Trace(x,s) (x).sequence
+#define priv_Trace(x,s) ((X11RequestId) { \
+	    .reqsource = s, \
+	    .sequence = (x).sequence })
 #endif
 
 typedef struct RequestErrorEventArgs
@@ -276,6 +280,7 @@ xcb_atom_t X11Adapter_atom(XAtomId id) ATTR_PURE;
 xcb_render_pictformat_t X11Adapter_rootformat(void);
 xcb_render_pictformat_t X11Adapter_format(PictFormat format);
 struct xkb_compose_table *X11Adapter_kbdcompose(void);
+uint32_t X11Adapter_keyCodepoint(xcb_keycode_t keycode);
 PSC_Event *X11Adapter_buttonpress(void) ATTR_RETNONNULL;
 PSC_Event *X11Adapter_buttonrelease(void) ATTR_RETNONNULL;
 PSC_Event *X11Adapter_clientmsg(void) ATTR_RETNONNULL;
@@ -293,11 +298,18 @@ PSC_Event *X11Adapter_selectionClear(void) ATTR_RETNONNULL;
 PSC_Event *X11Adapter_selectionNotify(void) ATTR_RETNONNULL;
 PSC_Event *X11Adapter_selectionRequest(void) ATTR_RETNONNULL;
 PSC_Event *X11Adapter_unmapNotify(void) ATTR_RETNONNULL;
+PSC_Event *X11Adapter_presentComplete(void) ATTR_RETNONNULL;
+/* args: the xcb_xkb_map_notify_event_t, or NULL for a new keyboard */
+PSC_Event *X11Adapter_keymapChanged(void) ATTR_RETNONNULL;
+int X11Adapter_hasPresent(void);
 PSC_Event *X11Adapter_requestError(void) ATTR_RETNONNULL;
 PSC_Event *X11Adapter_eventsDone(void) ATTR_RETNONNULL;
 const char *X11Adapter_wmClass(size_t *sz) ATTR_RETNONNULL;
 xcb_cursor_t X11Adapter_cursor(XCursor id);
 double X11Adapter_dpi(void);
+char *X11Adapter_cacheFile(const char *file, int create)
+    ATTR_NONNULL((1));
+char *X11Adapter_serverKey(void) ATTR_RETNONNULL;
 
 unsigned X11Adapter_await(X11RequestId reqid, void *ctx,
 	X11ReplyHandler handler) ATTR_NONNULL((3));
@@ -6,6 +6,7 @@
 
 #include "x11app.h"
 
+#include "profile.h"
 #include "suppress.h"
 #include "widget.h"
 #include "window.h"
@@ -64,15 +65,21 @@ static void svprestartup(void *receiver, void *sender, void *args)
     X11App *self = receiver;
     PSC_EAStartup *ea = args;
     int rc = 0;
+    int span = Profile_begin("prestartup", 0);
     Object_vcall(rc, X11App, prestartup, instance);
+    Profile_end(span);
     if (rc == EXIT_FAILURE) PSC_EAStartup_return(ea, EXIT_FAILURE);
     else if (rc != 0) self->quitting = 1;
-    else PSC_EAStartup_return(ea,
-	    X11Adapter_init(instance->argc, instance->argv,
+    else
+    {
+	span = Profile_begin("X11Adapter_init", 0);
+	rc = X11Adapter_init(instance->argc, instance->argv,
 		instance->locale.lc_ctype, instance->name,
 		instance->classname ? instance->classname
-		: Object_className(instance))
-	    ? EXIT_FAILURE : EXIT_SUCCESS);
+		: Object_className(instance));
+	Profile_end(span);
+	PSC_EAStartup_return(ea, rc ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
 }
 
 static void svstartup(void *receiver, void *sender, void *args)
@@ -92,7 +99,9 @@ static void svstartup(void *receiver, void *sender, void *args)
 #endif
     PSC_EAStartup *ea = args;
     int rc = 0;
+    int span = Profile_begin("startup", 0);
     Object_vcall(rc, X11App, startup, instance);
+    Profile_end(span);
     if (rc == EXIT_FAILURE) PSC_EAStartup_return(ea, EXIT_FAILURE);
     if (rc != 0) PSC_Service_quit();
 }
@@ -123,6 +132,7 @@ static void svshutdown(void *receiver, void *sender, void *args)
 
 static void destroy(void *obj)
 {
+    Profile_finish();
     X11Adapter_done();
     X11App *self = obj;
     PSC_Event_unregister(PSC_Service_shutdown(), self, svshutdown, 0);
@@ -135,7 +145,7 @@ static void destroy(void *obj)
     free(self->locale.lc_ctype);
     PSC_Event_destroy(self->error);
     PSC_List_destroy(self->windows);
-    free(self);
+    Object_free(self);
     instance = 0;
 }
 
@@ -264,11 +274,12 @@ X11App *app(void)
 X11App *X11App_createBase(void *derived, int argc, char **argv)
 {
     if (instance) return 0;
+    Profile_init(argc, argv);
     initPoser(argc, argv);
     AppLocale locale;
     if (getLocale(&locale) < 0) return 0;
 
-    X11App *self = PSC_malloc(sizeof *self);
+    X11App *self = NEWOBJ(sizeof *self);
     CREATEBASE(Object);
     self->windows = PSC_List_create();
     self->error = PSC_Event_create(self);
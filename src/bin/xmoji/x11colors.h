@@ -0,0 +1,11 @@
+#ifndef XMOJI_X11COLORS_H
+#define XMOJI_X11COLORS_H
+
+#include "valuetypes.h"
+
+#include <poser/decl.h>
+
+int X11Colors_lookup(Color *color, const char *name) ATTR_NONNULL((1))
+    ATTR_NONNULL((2));
+
+#endif
@@ -0,0 +1,246 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "x11stats.h"
+
+#include "object.h"
+
+#include <inttypes.h>
+#include <poser/core.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NBUCKETS 24
+#define MAXNAMELEN 64
+
+struct X11RequestStats
+{
+    char *name;
+    uint64_t totalUs;
+    uint64_t maxUs;
+    unsigned long count;
+    unsigned long completed;
+    unsigned long errors;
+    unsigned long hist[NBUCKETS];
+};
+
+static xcb_connection_t *c;
+static PSC_HashTable *byName;
+static X11RequestStats **all;
+static size_t nall;
+static size_t allcapa;
+static uint64_t started;
+static unsigned long hist[NBUCKETS];
+static unsigned long completed;
+static unsigned long syncs[2];
+static unsigned highWater;
+static int enabled;
+static volatile sig_atomic_t dumpRequested;
+
+static void handlesig(int signum)
+{
+    (void)signum;
+    dumpRequested = 1;
+}
+
+static void checkdump(void *receiver, void *sender, void *args)
+{
+    (void)receiver;
+    (void)sender;
+    (void)args;
+
+    if (!dumpRequested) return;
+    dumpRequested = 0;
+    if (enabled) X11Stats_dump();
+    else
+    {
+	/* The first signal just enables collecting statistics */
+	enabled = 1;
+	started = X11Stats_now();
+	PSC_Log_msg(PSC_L_INFO, "Collecting X11 request statistics");
+    }
+}
+
+static unsigned bucket(uint64_t us)
+{
+    unsigned b = 0;
+    while ((us >>= 1) && b < NBUCKETS - 1) ++b;
+    return b;
+}
+
+static uint64_t percentile(const unsigned long *h, unsigned long n,
+	unsigned pct)
+{
+    if (!n) return 0;
+    unsigned long sum = 0;
+    for (unsigned b = 0; b < NBUCKETS; ++b)
+    {
+	sum += h[b];
+	if (100 * sum >= (uint64_t)pct * n) return (uint64_t)2U << b;
+    }
+    return (uint64_t)2U << (NBUCKETS - 1);
+}
+
+static int compareTotal(const void *a, const void *b)
+{
+    const X11RequestStats *sa = *(const X11RequestStats *const *)a;
+    const X11RequestStats *sb = *(const X11RequestStats *const *)b;
+    if (sa->totalUs > sb->totalUs) return -1;
+    if (sa->totalUs < sb->totalUs) return 1;
+    return strcmp(sa->name, sb->name);
+}
+
+void X11Stats_init(xcb_connection_t *conn, int enable)
+{
+    if (c) return;
+    c = conn;
+    byName = PSC_HashTable_create(6);
+    struct sigaction sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sa_handler = handlesig;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR2, &sa, 0);
+    PSC_Event_register(PSC_Service_eventsDone(), 0, checkdump, 0);
+    if (enable)
+    {
+	enabled = 1;
+	started = X11Stats_now();
+    }
+}
+
+uint64_t X11Stats_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000U + ts.tv_nsec / 1000U;
+}
+
+X11RequestStats *X11Stats_request(const char *reqsource, unsigned waiting)
+{
+    if (!enabled) return 0;
+    if (waiting > highWater) highWater = waiting;
+
+    /* Aggregate by request type, which is the name of the xcb function */
+    char name[MAXNAMELEN];
+    size_t len = reqsource ? strcspn(reqsource, "( \t") : 0;
+    if (!len)
+    {
+	strcpy(name, "(unknown)");
+    }
+    else
+    {
+	if (len >= MAXNAMELEN) len = MAXNAMELEN - 1;
+	memcpy(name, reqsource, len);
+	name[len] = 0;
+    }
+
+    X11RequestStats *stats = PSC_HashTable_get(byName, name);
+    if (!stats)
+    {
+	stats = PSC_malloc(sizeof *stats);
+	memset(stats, 0, sizeof *stats);
+	stats->name = PSC_copystr(name);
+	PSC_HashTable_set(byName, stats->name, stats, 0);
+	if (nall == allcapa)
+	{
+	    allcapa += 32;
+	    all = PSC_realloc(all, allcapa * sizeof *all);
+	}
+	all[nall++] = stats;
+    }
+    ++stats->count;
+    return stats;
+}
+
+void X11Stats_completed(X11RequestStats *stats, uint64_t queued, int error)
+{
+    if (!stats) return;
+    uint64_t us = X11Stats_now() - queued;
+    unsigned b = bucket(us);
+    ++stats->hist[b];
+    ++hist[b];
+    ++stats->completed;
+    ++completed;
+    if (error) ++stats->errors;
+    stats->totalUs += us;
+    if (us > stats->maxUs) stats->maxUs = us;
+}
+
+void X11Stats_sync(X11SyncReason reason)
+{
+    if (enabled) ++syncs[reason];
+}
+
+void X11Stats_dump(void)
+{
+    if (!enabled) return;
+
+    unsigned long requests = 0;
+    for (size_t i = 0; i < nall; ++i) requests += all[i]->count;
+    uint64_t written = xcb_total_written(c);
+    uint64_t read = xcb_total_read(c);
+    qsort(all, nall, sizeof *all, compareTotal);
+
+    fprintf(stderr, "X11 request statistics after %.3f s:\n"
+	    "  requests: %lu (%lu completed), bytes written: %"PRIu64
+	    ", bytes read: %"PRIu64"\n"
+	    "  reply queue high-water mark: %u\n"
+	    "  syncs: %lu for requests without reply, %lu for full queue\n",
+	    (double)(X11Stats_now() - started) / 1000000.,
+	    requests, completed, written, read, highWater,
+	    syncs[X11SR_NOREPLY], syncs[X11SR_THRESHOLD]);
+    if (completed)
+    {
+	fputs("  latency histogram:\n", stderr);
+	for (unsigned b = 0; b < NBUCKETS; ++b)
+	{
+	    if (!hist[b]) continue;
+	    fprintf(stderr, "    < %8"PRIu64" us: %8lu (%5.1f%%)\n",
+		    (uint64_t)2U << b, hist[b],
+		    100. * hist[b] / completed);
+	}
+    }
+    fprintf(stderr, "  %-36s %8s %6s %9s %9s %9s %9s\n", "request",
+	    "count", "errors", "avg us", "~p50 us", "~p99 us", "max us");
+    for (size_t i = 0; i < nall; ++i)
+    {
+	const X11RequestStats *stats = all[i];
+	fprintf(stderr, "  %-36s %8lu %6lu %9"PRIu64" %9"PRIu64" %9"PRIu64
+		" %9"PRIu64"\n", stats->name, stats->count, stats->errors,
+		stats->completed ? stats->totalUs / stats->completed : 0,
+		percentile(stats->hist, stats->completed, 50),
+		percentile(stats->hist, stats->completed, 99),
+		stats->maxUs);
+    }
+    fputs("Object statistics:\n", stderr);
+    Object_printStats();
+    fflush(stderr);
+}
+
+void X11Stats_done(void)
+{
+    if (!c) return;
+    X11Stats_dump();
+    PSC_Event_unregister(PSC_Service_eventsDone(), 0, checkdump, 0);
+    signal(SIGUSR2, SIG_DFL);
+    for (size_t i = 0; i < nall; ++i)
+    {
+	free(all[i]->name);
+	free(all[i]);
+    }
+    free(all);
+    all = 0;
+    nall = 0;
+    allcapa = 0;
+    PSC_HashTable_destroy(byName);
+    byName = 0;
+    memset(hist, 0, sizeof hist);
+    memset(syncs, 0, sizeof syncs);
+    completed = 0;
+    highWater = 0;
+    enabled = 0;
+    dumpRequested = 0;
+    c = 0;
+}
@@ -0,0 +1,24 @@
+#ifndef XMOJI_X11STATS_H
+#define XMOJI_X11STATS_H
+
+#include <poser/decl.h>
+#include <stdint.h>
+#include <xcb/xcb.h>
+
+C_CLASS_DECL(X11RequestStats);
+
+typedef enum X11SyncReason
+{
+    X11SR_NOREPLY,	/* sync for requests without a reply */
+    X11SR_THRESHOLD	/* sync because too many requests were waiting */
+} X11SyncReason;
+
+void X11Stats_init(xcb_connection_t *c, int enable) ATTR_NONNULL((1));
+uint64_t X11Stats_now(void);
+X11RequestStats *X11Stats_request(const char *reqsource, unsigned waiting);
+void X11Stats_completed(X11RequestStats *stats, uint64_t queued, int error);
+void X11Stats_sync(X11SyncReason reason);
+void X11Stats_dump(void);
+void X11Stats_done(void);
+
+#endif
@@ -6,6 +6,7 @@
 #include "emojibutton.h"
 #include "emojifont.h"
 #include "emojihistory.h"
+#include "emojisearch.h"
 #include "flowgrid.h"
 #include "hbox.h"
 #include "hyperlink.h"
@@ -31,47 +32,108 @@
 #include "x11app.h"
 
 #include <poser/core.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 #define MAXSEARCHRESULTS 100
 #define SEARCHRESULTSZ 1024
+#define SEARCHDELAYMS 60
+#define SCALECACHESZ 3
 
 static int prestartup(void *app);
 static int startup(void *app);
 static void destroy(void *app);
+static void searchjobfinished(void *receiver, void *sender, void *args);
+static void onsearch(void *receiver, void *sender, void *args);
 
 static MetaX11App mo = MetaX11App_init(prestartup, startup, 0,
 	"Xmoji", destroy);
 
+typedef struct SearchJob
+{
+    EmojiSearch *search;
+    UniStr *pattern;
+    PSC_ThreadJob *job;
+    EmojiSearchMode mode;
+    int stale;
+    size_t resultsz;
+    const Emoji *results[SEARCHRESULTSZ];
+} SearchJob;
+
+typedef struct SearchSlot
+{
+    const Emoji *emoji;
+    size_t len;
+} SearchSlot;
+
 typedef struct Xmoji
 {
     Object base;
     const char *cfgfile;
+    const char *query;
+    const char *inject;
+    int atPointer;
+    int history;
     SingleInstance *instance;
     Config *config;
     Translator *uitexts;
     Translator *emojitexts;
+    EmojiSearch *search;
+    SearchJob *searchJob;
+    UniStr *searchPattern;
+    PSC_Timer *searchTimer;
+    SearchSlot searchSlots[MAXSEARCHRESULTS];
     Font *emojiFont;
-    Font *scaledEmojiFont;
+    Font *scaledFonts[EF_HUGE+1];
+    unsigned scaledUsed[EF_HUGE+1];
+    unsigned scaleTick;
     Window *mainWindow;
+    TextBox *searchBox;
     Window *aboutDialog;
     Window *settingsDialog;
     TabBox *tabs;
+    int searchDue;
+    int searchLanguagesChanged;
     FlowGrid *searchGrid;
     FlowGrid *recentGrid;
     Dropdown *instanceBox;
     Dropdown *scaleBox;
+    Dropdown *injectMethodBox;
     Dropdown *injectFlagsBox;
     SpinBox *waitBeforeBox;
     SpinBox *waitAfterBox;
     Dropdown *searchModeBox;
 } Xmoji;
 
+static void searchjobdiscarded(void *receiver, void *sender, void *args)
+{
+    (void)receiver;
+    (void)sender;
+
+    SearchJob *ctx = args;
+    EmojiSearch_destroy(ctx->search);
+    UniStr_destroy(ctx->pattern);
+    free(ctx);
+}
+
 static void destroy(void *app)
 {
     Xmoji *self = app;
-    Font_destroy(self->scaledEmojiFont);
+    for (int i = 0; i <= EF_HUGE; ++i) Font_destroy(self->scaledFonts[i]);
     Font_destroy(self->emojiFont);
+    if (self->searchJob)
+    {
+	/* The job might still run, so the index is destroyed together with
+	 * the job's context once it finished */
+	PSC_Event_unregister(PSC_ThreadJob_finished(self->searchJob->job),
+		self, searchjobfinished, 0);
+	PSC_Event_register(PSC_ThreadJob_finished(self->searchJob->job),
+		0, searchjobdiscarded, 0);
+	PSC_ThreadPool_cancel(self->searchJob->job);
+    }
+    else EmojiSearch_destroy(self->search);
+    PSC_Timer_destroy(self->searchTimer);
+    UniStr_destroy(self->searchPattern);
     Translator_destroy(self->emojitexts);
     Translator_destroy(self->uitexts);
     Config_destroy(self->config);
@@ -88,6 +150,82 @@ static void onsecondary(void *receiver, void *sender, void *args)
     Window_expose(self->mainWindow);
 }
 
+static void showsearch(Xmoji *self, const char *query)
+{
+    UniStr *text = UniStr_create(query);
+    TextBox_setText(self->searchBox, text);
+    /* Setting the text doesn't raise textChanged */
+    onsearch(self, 0, text);
+    UniStr_destroy(text);
+    TabBox_setTab(self->tabs, 0);
+}
+
+static int injectemoji(Xmoji *self, const char *emoji)
+{
+    if (!*emoji) return 0;
+    UniStr *text = UniStr_create(emoji);
+    KeyInjector_inject(text);
+    EmojiHistory_record(Config_history(self->config), text);
+    UniStr_destroy(text);
+    return 1;
+}
+
+static void oncommand(void *receiver, void *sender, void *args)
+{
+    (void)sender;
+
+    Xmoji *self = receiver;
+    SingleInstanceCommandEventArgs *ea = args;
+    switch (ea->command)
+    {
+	case SIC_SHOW:
+	    Window_expose(self->mainWindow);
+	    break;
+
+	case SIC_SHOWATPOINTER:
+	    Window_exposeAtPointer(self->mainWindow);
+	    break;
+
+	case SIC_SEARCH:
+	    showsearch(self, ea->arg);
+	    break;
+
+	case SIC_INJECT:
+	    ea->failed = !injectemoji(self, ea->arg);
+	    break;
+
+	case SIC_HISTORY:
+	    ea->reply = EmojiHistory_serialize(Config_history(self->config));
+	    break;
+    }
+}
+
+static int sendcommands(Xmoji *self)
+{
+    /* Hand the commands to an already running instance instead of starting
+     * another one. Any command that could be sent proves there is one. */
+    int running = 0;
+    if (self->atPointer || self->query || !(self->inject || self->history))
+    {
+	if (SingleInstance_send(self->instance, self->atPointer
+		    ? SIC_SHOWATPOINTER : SIC_SHOW, 0, 0) < 0) return 0;
+	running = 1;
+    }
+    if (self->query && SingleInstance_send(self->instance,
+		SIC_SEARCH, self->query, 0) >= 0) running = 1;
+    if (self->inject && SingleInstance_send(self->instance,
+		SIC_INJECT, self->inject, 0) >= 0) running = 1;
+    if (self->history)
+    {
+	char *history = 0;
+	if (SingleInstance_send(self->instance,
+		    SIC_HISTORY, 0, &history) >= 0) running = 1;
+	if (history) puts(history);
+	free(history);
+    }
+    return running;
+}
+
 static void onabout(void *receiver, void *sender, void *args)
 {
     (void)sender;
@@ -144,46 +282,167 @@ static void oninjected(void *receiver, void *sender, void *args)
     EmojiHistory_record(Config_history(self->config), txt);
 }
 
-static void onsearch(void *receiver, void *sender, void *args)
+static void showsearchresults(Xmoji *self,
+	const Emoji **results, size_t resultsz)
 {
-    (void)sender;
-
-    Xmoji *self = receiver;
-    const UniStr *str = args;
-    size_t resultsz = 0;
-    EmojiSearchMode mode = Config_emojiSearchMode(self->config);
-#ifndef WITH_NLS
-    mode = (mode & ESM_FULL) | ESM_ORIG;
-#endif
-    const Emoji *results[SEARCHRESULTSZ];
-    Widget_unselect(self->tabs);
-    if (str && UniStr_len(str) >= 3)
-    {
-	resultsz = Emoji_search(results, SEARCHRESULTSZ, MAXSEARCHRESULTS,
-		str, self->emojitexts, mode);
-    }
+    /* Results are keyed by their emoji, so buttons still showing the
+     * right one are left alone and moved results just swap buttons,
+     * without shaping their text again */
     size_t ridx = 0;
     for (size_t i = 0; i < MAXSEARCHRESULTS; ++i)
     {
 	void *button = FlowGrid_widgetAt(self->searchGrid, i);
-	EmojiButton_clearVariants(button);
-	if (ridx < resultsz)
+	if (ridx >= resultsz)
+	{
+	    if (Widget_isShown(button)) Widget_hide(button);
+	    continue;
+	}
+	SearchSlot slot = { results[ridx], 1 };
+	if (Emoji_variants(slot.emoji) > 1)
+	{
+	    while (ridx + slot.len < resultsz
+		    && !Emoji_variants(results[ridx + slot.len])) ++slot.len;
+	}
+	if (memcmp(self->searchSlots + i, &slot, sizeof slot))
 	{
-	    EmojiButton_setEmoji(button, results[ridx]);
-	    if (Emoji_variants(results[ridx]) > 1)
+	    size_t j;
+	    for (j = i + 1; j < MAXSEARCHRESULTS; ++j)
 	    {
-		EmojiButton_addVariant(button, results[ridx]);
-		while (++ridx < resultsz && !Emoji_variants(results[ridx]))
+		if (!memcmp(self->searchSlots + j, &slot, sizeof slot)) break;
+	    }
+	    if (j < MAXSEARCHRESULTS)
+	    {
+		FlowGrid_swapWidgets(self->searchGrid, i, j);
+		self->searchSlots[j] = self->searchSlots[i];
+		button = FlowGrid_widgetAt(self->searchGrid, i);
+	    }
+	    else
+	    {
+		EmojiButton_clearVariants(button);
+		EmojiButton_setEmoji(button, slot.emoji);
+		if (Emoji_variants(slot.emoji) > 1)
 		{
-		    EmojiButton_addVariant(button, results[ridx]);
+		    for (size_t v = 0; v < slot.len; ++v)
+		    {
+			EmojiButton_addVariant(button, results[ridx + v]);
+		    }
 		}
 	    }
-	    else ++ridx;
-	    Widget_show(button);
+	    self->searchSlots[i] = slot;
 	}
-	else Widget_hide(button);
+	if (!Widget_isShown(button)) Widget_show(button);
+	ridx += slot.len;
+    }
+}
+
+static void searchjob(void *arg)
+{
+    SearchJob *ctx = arg;
+    ctx->resultsz = EmojiSearch_match(ctx->search, ctx->results,
+	    SEARCHRESULTSZ, MAXSEARCHRESULTS, ctx->pattern, ctx->mode,
+	    !!ctx->job);
+}
+
+static void startsearch(Xmoji *self)
+{
+    /* Only one job runs at a time, so the index can't change under it.
+     * A superseded job is canceled, the newest pattern is searched once
+     * it finished. */
+    if (!self->searchDue || self->searchJob) return;
+    self->searchDue = 0;
+
+    SearchJob *ctx = PSC_malloc(sizeof *ctx);
+    ctx->search = self->search;
+    ctx->pattern = self->searchPattern;
+    self->searchPattern = 0;
+    ctx->job = 0;
+    ctx->mode = Config_emojiSearchMode(self->config);
+#ifndef WITH_NLS
+    ctx->mode = (ctx->mode & ESM_FULL) | ESM_ORIG;
+#endif
+    ctx->stale = 0;
+    ctx->resultsz = 0;
+    EmojiSearch_prepare(self->search, ctx->mode);
+    self->searchJob = ctx;
+
+    if (PSC_ThreadPool_active())
+    {
+	ctx->job = PSC_ThreadJob_create(searchjob, ctx, 0);
+	PSC_Event_register(PSC_ThreadJob_finished(ctx->job),
+		self, searchjobfinished, 0);
+	PSC_ThreadPool_enqueue(ctx->job);
+	return;
+    }
+
+    searchjob(ctx);
+    searchjobfinished(self, 0, ctx);
+}
+
+static void searchjobfinished(void *receiver, void *sender, void *args)
+{
+    Xmoji *self = receiver;
+    PSC_ThreadJob *job = sender;
+    SearchJob *ctx = args;
+
+    if (self->searchJob == ctx) self->searchJob = 0;
+    if ((!job || PSC_ThreadJob_hasCompleted(job)) && !ctx->stale)
+    {
+	showsearchresults(self, ctx->results, ctx->resultsz);
     }
-    Widget_invalidate(self->searchGrid);
+    UniStr_destroy(ctx->pattern);
+    free(ctx);
+
+    if (self->searchLanguagesChanged)
+    {
+	EmojiSearch_setLanguages(self->search,
+		Config_searchLanguages(self->config));
+	self->searchLanguagesChanged = 0;
+    }
+    startsearch(self);
+}
+
+static void onsearchtimer(void *receiver, void *sender, void *args)
+{
+    (void)sender;
+    (void)args;
+
+    Xmoji *self = receiver;
+    self->searchDue = 1;
+    startsearch(self);
+}
+
+static void onsearch(void *receiver, void *sender, void *args)
+{
+    (void)sender;
+
+    Xmoji *self = receiver;
+    const UniStr *str = args;
+    Widget_unselect(self->tabs);
+    if (self->searchJob)
+    {
+	self->searchJob->stale = 1;
+	if (self->searchJob->job) PSC_ThreadPool_cancel(self->searchJob->job);
+    }
+    UniStr_destroy(self->searchPattern);
+    self->searchPattern = 0;
+    self->searchDue = 0;
+    if (!str || UniStr_len(str) < 3)
+    {
+	if (self->searchTimer) PSC_Timer_stop(self->searchTimer);
+	showsearchresults(self, 0, 0);
+	return;
+    }
+    /* The TextBox keeps editing its buffer while the job runs */
+    self->searchPattern = UniStr_create(UniStr_str(str));
+    if (!self->searchTimer)
+    {
+	self->searchTimer = PSC_Timer_create();
+	PSC_Timer_setMs(self->searchTimer, SEARCHDELAYMS);
+	PSC_Event_register(PSC_Timer_expired(self->searchTimer), self,
+		onsearchtimer, 0);
+    }
+    PSC_Timer_stop(self->searchTimer);
+    PSC_Timer_start(self->searchTimer, 0);
 }
 
 static void onhistorychanged(void *receiver, void *sender, void *args)
@@ -248,22 +507,39 @@ static void onscalechanged(void *receiver, void *sender, void *args)
     Xmoji *self = receiver;
     ConfigChangedEventArgs *ea = args;
 
-    X11App_showWaitCursor();
     EmojiFont scale = Config_scale(self->config);
-    Font *scaled;
-    if (scale == EF_TINY)
+    if (!self->scaledFonts[scale])
     {
-	scaled = Font_ref(self->emojiFont);
+	X11App_showWaitCursor();
+	if (scale == EF_TINY)
+	{
+	    self->scaledFonts[scale] = Font_ref(self->emojiFont);
+	}
+	else
+	{
+	    static const double factors[] = { 1.5, 2., 3., 4.};
+	    self->scaledFonts[scale] = Font_createVariant(self->emojiFont,
+		    factors[scale-1] * Font_pixelsize(self->emojiFont), 0, 0);
+	}
     }
-    else
+    self->scaledUsed[scale] = ++self->scaleTick;
+
+    /* Keep recently used scales alive, so their glyphsets don't have to
+     * be rendered again when switching back */
+    int cached = 0;
+    int lru = -1;
+    for (int i = 0; i <= EF_HUGE; ++i)
+    {
+	if (!self->scaledFonts[i]) continue;
+	++cached;
+	if (lru < 0 || self->scaledUsed[i] < self->scaledUsed[lru]) lru = i;
+    }
+    if (cached > SCALECACHESZ)
     {
-	static const double factors[] = { 1.5, 2., 3., 4.};
-	scaled = Font_createVariant(self->emojiFont,
-		factors[scale-1] * Font_pixelsize(self->emojiFont), 0, 0);
+	Font_destroy(self->scaledFonts[lru]);
+	self->scaledFonts[lru] = 0;
     }
-    Font_destroy(self->scaledEmojiFont);
-    self->scaledEmojiFont = scaled;
-    Widget_setFont(self->tabs, self->scaledEmojiFont);
+    Widget_setFont(self->tabs, self->scaledFonts[scale]);
 
     if (ea->external)
     {
@@ -301,18 +577,40 @@ static void onflagschanged(void *receiver, void *sender, void *args)
 
     if (ea->external)
     {
+	Dropdown_select(self->injectMethodBox,
+		!!(Config_injectorFlags(self->config) & IF_PASTE));
 	Dropdown_select(self->injectFlagsBox,
 		flagsindex(Config_injectorFlags(self->config)));
     }
 }
 
+static void onmethodboxchanged(void *receiver, void *sender, void *args)
+{
+    (void)sender;
+
+    Xmoji *self = receiver;
+    unsigned *val = args;
+    InjectorFlags flags = Config_injectorFlags(self->config) & ~IF_PASTE;
+    if (*val) flags |= IF_PASTE;
+    Config_setInjectorFlags(self->config, flags);
+}
+
+static void onpastekeyschanged(void *receiver, void *sender, void *args)
+{
+    (void)sender;
+    (void)args;
+
+    Xmoji *self = receiver;
+    KeyInjector_initPaste(self->mainWindow, Config_pasteKeys(self->config));
+}
+
 static void onflagsboxchanged(void *receiver, void *sender, void *args)
 {
     (void)sender;
 
     Xmoji *self = receiver;
     unsigned flagsval = *(unsigned *)args;
-    InjectorFlags flags = 0;
+    InjectorFlags flags = Config_injectorFlags(self->config) & IF_PASTE;
     if (flagsval > 2)
     {
 	flags |= IF_EXTRAZWJ;
@@ -378,7 +676,7 @@ static void onwaitafterboxchanged(void *receiver, void *sender, void *args)
 
 static unsigned searchmodeindex(EmojiSearchMode mode)
 {
-    unsigned index = mode - 1;
+    unsigned index = (mode & ~ESM_KEYWORDS) - 1;
     if (index > 3) --index;
     if (index > 5) index = 5;
     return index;
@@ -404,7 +702,22 @@ static void onsearchmodeboxchanged(void *receiver, void *sender, void *args)
 
     Xmoji *self = receiver;
     unsigned *val = args;
-    Config_setEmojiSearchMode(self->config, *val + (*val > 2) + 1);
+    EmojiSearchMode keywords =
+	Config_emojiSearchMode(self->config) & ESM_KEYWORDS;
+    Config_setEmojiSearchMode(self->config,
+	    keywords | (*val + (*val > 2) + 1));
+}
+
+static void onsearchlanguageschanged(void *receiver, void *sender,
+	void *args)
+{
+    (void)sender;
+    (void)args;
+
+    Xmoji *self = receiver;
+    if (self->searchJob) self->searchLanguagesChanged = 1;
+    else EmojiSearch_setLanguages(self->search,
+	    Config_searchLanguages(self->config));
 }
 
 static int prestartup(void *app)
@@ -429,6 +742,19 @@ static int prestartup(void *app)
     self->instance = SingleInstance_create();
     PSC_Event_register(SingleInstance_secondary(self->instance), self,
 	    onsecondary, 0);
+    PSC_Event_register(SingleInstance_command(self->instance), self,
+	    oncommand, 0);
+    if (Config_singleInstance(self->config) && sendcommands(self))
+    {
+	return -1;
+    }
+    if (self->history)
+    {
+	char *history = EmojiHistory_serialize(Config_history(self->config));
+	if (history) puts(history);
+	free(history);
+	return -1;
+    }
     if (Config_singleInstance(self->config)
 	    && !SingleInstance_start(self->instance))
     {
@@ -443,6 +769,12 @@ static int prestartup(void *app)
 	    X11App_lcMessages(), XMU_get);
     self->emojitexts = Translator_create("xmoji-emojis",
 	    X11App_lcMessages(), XME_get);
+    self->search = EmojiSearch_create(self->emojitexts,
+	    X11App_lcMessages());
+    EmojiSearch_setLanguages(self->search,
+	    Config_searchLanguages(self->config));
+    PSC_Event_register(Config_searchLanguagesChanged(self->config), self,
+	    onsearchlanguageschanged, 0);
 
     return 0;
 }
@@ -499,6 +831,9 @@ static int startup(void *app)
     KeyInjector_init(Config_waitBefore(self->config),
 	    Config_waitAfter(self->config),
 	    Config_injectorFlags(self->config));
+    KeyInjector_initPaste(win, Config_pasteKeys(self->config));
+    PSC_Event_register(Config_pasteKeysChanged(self->config), self,
+	    onpastekeyschanged, 0);
 
     /* Create emoji font */
     FontOptions options = {
@@ -530,6 +865,7 @@ static int startup(void *app)
     PSC_Event_register(TextBox_textChanged(search), self, onsearch, 0);
     Widget_show(search);
     VBox_addWidget(box, search);
+    self->searchBox = search;
     ScrollBox *scroll = ScrollBox_create(0, box);
     FlowGrid *grid = FlowGrid_create(scroll);
     FlowGrid_setSpacing(grid, (Size){0, 0});
@@ -797,6 +1133,23 @@ static int startup(void *app)
     Widget_show(row);
     Table_addRow(table, row);
     row = TableRow_create(table);
+    Widget_setTooltip(row, TR(tr, XMU_txt_injectMethodDesc), 0);
+    label = TextLabel_create("injectMethodLabel", row);
+    TextLabel_setText(label, TR(tr, XMU_txt_injectMethod));
+    Widget_setAlign(label, AH_RIGHT|AV_MIDDLE);
+    Widget_show(label);
+    HBox_addWidget(row, label);
+    dd = Dropdown_create("injectMethodBox", row);
+    Dropdown_addOption(dd, TR(tr, XMU_txt_methodKeys));
+    Dropdown_addOption(dd, TR(tr, XMU_txt_methodPaste));
+    Dropdown_select(dd, !!(Config_injectorFlags(self->config) & IF_PASTE));
+    Widget_show(dd);
+    HBox_addWidget(row, dd);
+    self->injectMethodBox = dd;
+    PSC_Event_register(Dropdown_selected(dd), self, onmethodboxchanged, 0);
+    Widget_show(row);
+    Table_addRow(table, row);
+    row = TableRow_create(table);
     Widget_setTooltip(row, TR(tr, XMU_txt_injectFlagsDesc), 0);
     label = TextLabel_create("injectFlagsLabel", row);
     TextLabel_setText(label, TR(tr, XMU_txt_injectFlags));
@@ -889,6 +1242,9 @@ static int startup(void *app)
     /* All done, show main window */
     Icon_destroy(appIcon);
     Widget_show(win);
+    if (self->atPointer) Window_exposeAtPointer(win);
+    if (self->query) showsearch(self, self->query);
+    if (self->inject) injectemoji(self, self->inject);
     return 0;
 }
 
@@ -897,13 +1253,14 @@ Xmoji *Xmoji_create(int argc, char **argv)
     Xmoji *self = PSC_malloc(sizeof *self);
     memset(self, 0, sizeof *self);
     CREATEFINALBASE(X11App, argc, argv);
-    for (int i = 1; i < argc-1; ++i)
+    for (int i = 1; i < argc; ++i)
     {
-	if (!strcmp(argv[i], "-cfg"))
-	{
-	    self->cfgfile = argv[++i];
-	    break;
-	}
+	if (!strcmp(argv[i], "-pointer")) self->atPointer = 1;
+	else if (!strcmp(argv[i], "-history")) self->history = 1;
+	else if (i == argc-1) break;
+	else if (!strcmp(argv[i], "-cfg")) self->cfgfile = argv[++i];
+	else if (!strcmp(argv[i], "-query")) self->query = argv[++i];
+	else if (!strcmp(argv[i], "-inject")) self->inject = argv[++i];
     }
     return self;
 }
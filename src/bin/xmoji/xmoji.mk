@@ -8,6 +8,8 @@ GEN_EMOJINM_tool=	$(EMOJIGEN_TARGET)
 GEN_EMOJINM_args=	emojinames $1 $2
 GEN_EMOJITRANS_tool=	$(EMOJIGEN_TARGET)
 GEN_EMOJITRANS_args=	translate $1 $2 $3 $4
+GEN_EMOJIKW_tool=	$(EMOJIGEN_TARGET)
+GEN_EMOJIKW_args=	keywords $1 $2 $3 $4
 GEN_TEXTS_tool=		$(XTC_TARGET)
 GEN_TEXTS_args=		source $(basename $1) XMU $2
 GEN_TRANS_tool=		$(XTC_TARGET)
@@ -37,6 +39,8 @@ xmoji_MODULES=		button \
 			emoji \
 			emojibutton \
 			emojihistory \
+			emojikeywords \
+			emojisearch \
 			filewatcher \
 			flowgrid \
 			flyout \
@@ -51,6 +55,7 @@ xmoji_MODULES=		button \
 			object \
 			pen \
 			pixmap \
+			profile \
 			scrollbox \
 			shape \
 			singleinstance \
@@ -72,6 +77,8 @@ xmoji_MODULES=		button \
 			window \
 			x11adapter \
 			x11app \
+			x11colors \
+			x11stats \
 			xdgopen \
 			xmoji \
 			xrdb \
@@ -89,7 +96,7 @@ xmoji_transdir=		$(xmoji_datadir)/translations
 xmoji_TEXTS_FILES=	texts.c:$(xmoji_UITXT)
 xmoji_TRANSLATIONS=	xmoji-ui xmoji-emojis
 xmoji_LANGUAGES=	de
-xmoji_LDFLAGS=		-Wl,--as-needed
+xmoji_LDFLAGS=		-Wl,--as-needed -pthread
 xmoji_LIBS=		m
 xmoji_PKGDEPS=		fontconfig \
 			harfbuzz \
@@ -97,6 +104,7 @@ xmoji_PKGDEPS=		fontconfig \
 			xcb >= 1.14 \
 			xcb-cursor \
 			xcb-image \
+			xcb-present \
 			xcb-render \
 			xcb-xkb \
 			xcb-xtest \
@@ -139,13 +147,12 @@ ifeq ($(BUNDLED_POSER),1)
 xmoji_STATICDEPS+=	posercore
 xmoji_PRECFLAGS+=	-I./poser/include
 xmoji_LIBS+=		posercore
-xmoji_LDFLAGS+=		-pthread
 else
 xmoji_PKGDEPS+=		posercore >= 1.2.2
 endif
 
 ifeq ($(WITH_NLS),1)
-xmoji_GEN+=		EMOJINM EMOJITRANS TRANS
+xmoji_GEN+=		EMOJINM EMOJITRANS EMOJIKW TRANS
 xmoji_EMOJINM_FILES=	translations/xmoji-emojis.def:$(xmoji_EMOJIDATA)
 xmoji_CLDR=		contrib/cldr/annotations
 xmoji_cldrfiles=	$(xmoji_CLDR)/$1.xml:$(xmoji_CLDR)Derived/$1.xml
@@ -153,11 +160,15 @@ xmoji_emojitexts=	translations/xmoji-emojis-$1.def:$(xmoji_EMOJIDATA)
 xmoji_emojitrans=	$(call xmoji_emojitexts,$1):$(call xmoji_cldrfiles,$1)
 xmoji_EMOJITRANS_FILES=	$(foreach l,$(xmoji_LANGUAGES),$(call \
 			xmoji_emojitrans,$l):translations/xmoji-emojis.def)
+xmoji_emojikw=		translations/xmoji-keywords-$1.xkw:$(xmoji_EMOJIDATA)
+xmoji_EMOJIKW_FILES=	$(foreach l,$(xmoji_LANGUAGES),$(call \
+			xmoji_emojikw,$l):$(call xmoji_cldrfiles,$l))
 xmoji_TRANS_FILES=	$(foreach \
 	t,$(xmoji_TRANSLATIONS),$(foreach l,$(xmoji_LANGUAGES),\
 	translations/$t-$l.xct:translations/$t.def:translations/$t-$l.def))
 xmoji_EXTRADIRS=	trans
-xmoji_trans_FILES=	$(filter %.xct,$(subst :, ,$(xmoji_TRANS_FILES)))
+xmoji_trans_FILES=	$(filter %.xct,$(subst :, ,$(xmoji_TRANS_FILES))) \
+			$(filter %.xkw,$(subst :, ,$(xmoji_EMOJIKW_FILES)))
 xmoji_DEFINES+=		-DWITH_NLS -DTRANSDIR=\"$(xmoji_transdir)\"
 xmoji_PREBUILD+=	$(addprefix $(xmoji_SRCDIR)/,$(xmoji_trans_FILES))
 endif
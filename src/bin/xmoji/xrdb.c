@@ -4,6 +4,7 @@
 #include <errno.h>
 #include <poser/core.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -17,10 +18,31 @@ typedef struct XRdbEntry {
     unsigned key[];
 } XRdbEntry;
 
-typedef struct XRdbQualifiedEntry {
-    XRdbEntry *entry;
-    int quality;
-} XRdbQualifiedEntry;
+typedef struct XRdbNode {
+    const char *value;
+    struct XRdbNode *children;
+    unsigned id;
+    unsigned order;
+    unsigned nchildren;
+} XRdbNode;
+
+/* Entries compiled into a trie keyed by component ids, plus a memo of
+ * query results keyed by the resolved instance and class ids. Built lazily
+ * on the first query and dropped whenever entries change. */
+typedef struct XRdbIndex {
+    XRdbNode root;
+    PSC_HashTable *memo;
+    int valid;
+} XRdbIndex;
+
+typedef struct XRdbQuery {
+    const unsigned *instid;
+    const unsigned *classid;
+    const XRdbNode *result;
+    unsigned keylen;
+    int quality[XRDB_KEYLEN];
+    int best[XRDB_KEYLEN];
+} XRdbQuery;
 
 struct XRdb {
     PSC_HashTable *ids;
@@ -28,6 +50,7 @@ struct XRdb {
     PSC_HashTable *overrides;
     PSC_List *keys;
     PSC_List *entries;
+    XRdbIndex *index;
     char *root;
     char **argv;
     int argc;
@@ -76,6 +99,25 @@ static void destroyentry(void *obj)
     free(entry);
 }
 
+static void destroynode(XRdbNode *node)
+{
+    for (unsigned i = 0; i < node->nchildren; ++i)
+    {
+	destroynode(node->children + i);
+    }
+    free(node->children);
+}
+
+static void invalidate(XRdb *self)
+{
+    if (!self->index->valid) return;
+    destroynode(&self->index->root);
+    memset(&self->index->root, 0, sizeof self->index->root);
+    PSC_HashTable_destroy(self->index->memo);
+    self->index->memo = 0;
+    self->index->valid = 0;
+}
+
 static size_t XRdb_parseEntry(XRdb *self, const char *str, size_t slen)
 {
     size_t pos = 0;
@@ -146,6 +188,7 @@ static size_t XRdb_parseEntry(XRdb *self, const char *str, size_t slen)
     }
     if (vallen == sizeof valstr) return slen;
     valstr[vallen] = 0;
+    invalidate(self);
     for (size_t i = 0; i < PSC_List_size(self->entries); ++i)
     {
 	XRdbEntry *entry = PSC_List_at(self->entries, i);
@@ -191,6 +234,8 @@ XRdb *XRdb_create(const char *str, size_t slen,
     self->overrides = 0;
     self->keys = PSC_List_create();
     self->entries = PSC_List_create();
+    self->index = PSC_malloc(sizeof *self->index);
+    memset(self->index, 0, sizeof *self->index);
     self->argv = 0;
     self->argc = 0;
 
@@ -225,11 +270,131 @@ void XRdb_setOverrides(XRdb *self, int argc, char **argv)
     self->argv = argv;
 }
 
-static int lowerqual(void *obj, const void *arg)
+static const XRdbNode *child(const XRdbNode *node, unsigned id)
+{
+    unsigned lo = 0;
+    unsigned hi = node->nchildren;
+    while (lo < hi)
+    {
+	unsigned mid = lo + ((hi - lo) >> 1);
+	const XRdbNode *c = node->children + mid;
+	if (c->id == id) return c;
+	if (c->id < id) lo = mid + 1;
+	else hi = mid;
+    }
+    return 0;
+}
+
+static XRdbNode *addchild(XRdbNode *node, unsigned id)
+{
+    unsigned pos = 0;
+    while (pos < node->nchildren && node->children[pos].id < id) ++pos;
+    if (pos < node->nchildren && node->children[pos].id == id)
+    {
+	return node->children + pos;
+    }
+    node->children = PSC_realloc(node->children,
+	    (node->nchildren + 1) * sizeof *node->children);
+    memmove(node->children + pos + 1, node->children + pos,
+	    (node->nchildren - pos) * sizeof *node->children);
+    ++node->nchildren;
+    XRdbNode *c = node->children + pos;
+    memset(c, 0, sizeof *c);
+    c->id = id;
+    return c;
+}
+
+static void compile(const XRdb *self)
+{
+    XRdbIndex *index = self->index;
+    unsigned order = 0;
+    PSC_ListIterator *i = PSC_List_iterator(self->entries);
+    while (PSC_ListIterator_moveNext(i))
+    {
+	XRdbEntry *entry = PSC_ListIterator_current(i);
+	XRdbNode *node = &index->root;
+	for (unsigned kpos = 0; kpos < entry->keylen; ++kpos)
+	{
+	    node = addchild(node, entry->key[kpos]);
+	}
+	node->value = entry->value;
+	node->order = order++;
+    }
+    PSC_ListIterator_destroy(i);
+    index->memo = PSC_HashTable_create(8);
+    index->valid = 1;
+}
+
+/* The precedence rules compare the quality of the components matched at
+ * each position of the query, the first position with a difference
+ * decides. Remaining ties go to the entry defined first. */
+static int qualitycmp(const int *a, const int *b, unsigned len)
+{
+    for (unsigned i = 0; i < len; ++i)
+    {
+	if (a[i] != b[i]) return a[i] > b[i] ? 1 : -1;
+    }
+    return 0;
+}
+
+static int worse(const XRdbQuery *q, unsigned kpos)
+{
+    return q->result && qualitycmp(q->quality, q->best, kpos + 1) < 0;
+}
+
+static void walk(XRdbQuery *q, const XRdbNode *node, unsigned kpos,
+	int tight);
+
+/* Entries continuing with '*' skip query components until the component
+ * following the '*' matches for the first time. Components after it that
+ * already matched earlier in that range are not available any more. */
+static void walkflex(XRdbQuery *q, const XRdbNode *flex, unsigned kpos,
+	unsigned from, int tight)
+{
+    if (kpos == q->keylen) return;
+    unsigned ids[] = { q->instid[kpos], q->classid[kpos] };
+    for (unsigned n = 0; n < 2; ++n)
+    {
+	if (n && ids[1] == ids[0]) break;
+	const XRdbNode *c = child(flex, ids[n]);
+	if (!c) continue;
+	unsigned k;
+	for (k = from; k < kpos && q->instid[k] != ids[n]
+		&& q->classid[k] != ids[n]; ++k);
+	if (k < kpos) continue;
+	q->quality[kpos] = n ? 4 : 6;
+	if (!worse(q, kpos)) walk(q, c, kpos + 1, 1);
+    }
+    q->quality[kpos] = tight;
+    if (!worse(q, kpos)) walkflex(q, flex, kpos + 1, from, tight);
+}
+
+static void walk(XRdbQuery *q, const XRdbNode *node, unsigned kpos,
+	int tight)
 {
-    XRdbQualifiedEntry *qe = obj;
-    const int *bestqual = arg;
-    return qe->quality < *bestqual;
+    if (kpos == q->keylen)
+    {
+	if (!node->value) return;
+	int cmp = q->result ? qualitycmp(q->quality, q->best, q->keylen) : 1;
+	if (cmp > 0 || (cmp == 0 && node->order < q->result->order))
+	{
+	    q->result = node;
+	    memcpy(q->best, q->quality, q->keylen * sizeof *q->best);
+	}
+	return;
+    }
+    unsigned ids[] = { q->instid[kpos], q->classid[kpos], XRDB_WILDCARD };
+    static const int quality[] = { 6, 4, 2 };
+    for (unsigned n = 0; n < 3; ++n)
+    {
+	if (n == 1 && ids[1] == ids[0]) continue;
+	const XRdbNode *c = child(node, ids[n]);
+	if (!c) continue;
+	q->quality[kpos] = tight + quality[n];
+	if (!worse(q, kpos)) walk(q, c, kpos + 1, 1);
+    }
+    const XRdbNode *flex = child(node, XRDB_FLEX);
+    if (flex) walkflex(q, flex, kpos, kpos, tight);
 }
 
 const char *XRdb_value(const XRdb *self, XRdbKey key, XRdbQueryFlags flags)
@@ -261,84 +426,29 @@ const char *XRdb_value(const XRdb *self, XRdbKey key, XRdbQueryFlags flags)
 	const char *oval = getOverride(self, key[arglen-1]);
 	if (oval) return oval;
     }
-    PSC_List *matches = PSC_List_create();
-    PSC_ListIterator *i = PSC_List_iterator(self->entries);
-    while (PSC_ListIterator_moveNext(i))
-    {
-	XRdbEntry *entry = PSC_ListIterator_current(i);
-	unsigned ekpos = 0;
-	unsigned kpos = 0;
-	int match = 1;
-	while (match && kpos < keylen)
-	{
-	    if (ekpos == entry->keylen) match = 0;
-	    else if (entry->key[ekpos] == instid[kpos]
-		    || entry->key[ekpos] == classid[kpos]
-		    || entry->key[ekpos] == XRDB_WILDCARD) ++ekpos;
-	    else if (entry->key[ekpos] == XRDB_FLEX)
-	    {
-		if (ekpos + 1 < entry->keylen &&
-			(entry->key[ekpos+1] == instid[kpos] ||
-			 entry->key[ekpos+1] == classid[kpos])) ekpos += 2;
-	    }
-	    else match = 0;
-	    ++kpos;
-	}
-	if (match && ekpos == entry->keylen)
-	{
-	    XRdbQualifiedEntry *qe = PSC_malloc(sizeof *qe);
-	    qe->entry = entry;
-	    qe->quality = 0;
-	    PSC_List_append(matches, qe, free);
-	}
-    }
-    PSC_ListIterator_destroy(i);
-    char *result = 0;
-    if (!PSC_List_size(matches)) goto done;
-    unsigned checkpos = 0;
-    while (checkpos < keylen && PSC_List_size(matches) > 1)
+    if (!self->index->valid) compile(self);
+
+    /* Component names without an id can't match any entry, so the ids
+     * fully determine the result */
+    char memokey[XRDB_KEYLEN * 18 + 1];
+    char *mk = memokey;
+    for (unsigned kpos = 0; kpos < keylen; ++kpos)
     {
-	int bestqual = 0;
-	for (size_t idx = 0; idx < PSC_List_size(matches); ++idx)
-	{
-	    XRdbQualifiedEntry *qe = PSC_List_at(matches, idx);
-	    XRdbEntry *entry = qe->entry;
-	    unsigned ekpos = 0;
-	    for (unsigned kpos = 0; kpos < checkpos; ++kpos)
-	    {
-		if (entry->key[ekpos] == instid[kpos]
-			|| entry->key[ekpos] == classid[kpos]
-			|| entry->key[ekpos] == XRDB_WILDCARD) ++ekpos;
-		else if (entry->key[ekpos] == XRDB_FLEX &&
-			ekpos + 1 < entry->keylen &&
-			( entry->key[ekpos+1] == instid[kpos]
-			  || entry->key[ekpos+1] == classid[kpos])) ekpos += 2;
-	    }
-	    int quality = 0;
-	    if (ekpos < entry->keylen && entry->key[ekpos] == XRDB_FLEX &&
-		    (entry->key[ekpos+1] == instid[checkpos] ||
-		     entry->key[ekpos+1] == classid[checkpos])) ++ekpos;
-	    if (ekpos > 0 && entry->key[ekpos-1] != XRDB_FLEX) quality = 1;
-	    if (entry->key[ekpos] != XRDB_FLEX)
-	    {
-		quality += 2;
-		if (entry->key[ekpos] != XRDB_WILDCARD)
-		{
-		    quality += 2;
-		    if (entry->key[ekpos] == instid[checkpos]) quality += 2;
-		}
-	    }
-	    qe->quality = quality;
-	    if (quality > bestqual) bestqual = quality;
-	}
-	PSC_List_removeAll(matches, lowerqual, &bestqual);
-	++checkpos;
+	mk += sprintf(mk, "%x.%x;", instid[kpos], classid[kpos]);
     }
-    XRdbQualifiedEntry *qe = PSC_List_at(matches, 0);
-    result = qe->entry->value;
+    const char *result = PSC_HashTable_get(self->index->memo, memokey);
+    if (result) return result == (char *)-1 ? 0 : result;
 
-done:
-    PSC_List_destroy(matches);
+    XRdbQuery q = {
+	.instid = instid,
+	.classid = classid,
+	.result = 0,
+	.keylen = keylen
+    };
+    walk(&q, &self->index->root, 0, 0);
+    result = q.result ? q.result->value : 0;
+    PSC_HashTable_set(self->index->memo, memokey,
+	    result ? (char *)result : (char *)-1, 0);
     return result;
 }
 
@@ -400,6 +510,8 @@ void XRdb_destroy(XRdb *self)
 {
     if (!self) return;
     free(self->root);
+    invalidate(self);
+    free(self->index);
     PSC_List_destroy(self->entries);
     PSC_List_destroy(self->keys);
     PSC_HashTable_destroy(self->overrides);
@@ -2,8 +2,10 @@
 
 #include "object.h"
 #include "unistr.h"
+#include "unistrbuilder.h"
 #include "window.h"
 #include "x11adapter.h"
+#include "xrdb.h"
 
 #include <poser/core.h>
 #include <stdlib.h>
@@ -12,6 +14,8 @@
 #define MAXREQUESTORS 16
 #define REQUESTTIMEOUT 10000
 #define CONVERTTIMEOUT 2000
+#define DEFMAXLEN (1L << 20)
+#define MAXMAXLEN (1L << 26)
 
 #define NOCONTENT (XSelectionContent){0, XST_NONE}
 
@@ -25,9 +29,11 @@ struct XSelectionRequest
     XSelectionRequest *parent;
     XSelectionRequest *subreqs;
     PSC_Timer *timeout;
+    UniStr *text;
     void *data;
     size_t datalen;
     size_t datapos;
+    size_t textpos;
     xcb_atom_t property;
     xcb_atom_t proptype;
     xcb_atom_t target;
@@ -62,13 +68,14 @@ struct XSelectionConvert
     XSelectionConvert *next;
     Widget *requestor;
     PSC_Timer *timeout;
-    void *data;
-    size_t datalen;
+    UniStrBuilder *text;
     XSelectionCallback received;
     XSelectionType type;
     xcb_atom_t property;
     xcb_atom_t proptype;
     xcb_atom_t target;
+    char pending[4];
+    uint8_t npending;
     uint8_t recvincr;
 };
 
@@ -76,6 +83,8 @@ static void XSelectionConvert_done(XSelectionConvert *self, int destroy);
 static void XSelectionConvert_abort(XSelectionConvert *self);
 static void XSelectionConvert_readIncr(
 	void *receiver, void *sender, void *args);
+static void XSelectionConvert_decode(XSelectionConvert *self,
+	const char *data, size_t len);
 static void XSelectionConvert_readProperty(void *obj, unsigned sequence,
 	void *reply, xcb_generic_error_t *error);
 static void XSelectionConvert_notify(XSelectionConvert *self);
@@ -94,6 +103,7 @@ struct XSelection
     XSelectionConvert *conversions;
     XSelectionRequest *requests[MAXREQUESTORS];
     size_t maxproplen;
+    size_t maxlen;
     XSelectionContent content;
     XSelectionContent newContent;
     xcb_timestamp_t ownedTime;
@@ -171,6 +181,7 @@ static void XSelectionRequest_done(XSelectionRequest *self, int destroy)
 {
     if (destroy && !self) return;
     PSC_Timer_destroy(self->timeout);
+    UniStr_destroy(self->text);
     free(self->data);
     if (self->sendincr)
     {
@@ -292,6 +303,29 @@ static void XSelectionRequest_checkError(void *obj, unsigned sequence,
     }
 }
 
+/* Text is converted one chunk at a time while it is sent, so the whole
+ * converted text never needs to exist in memory */
+static size_t XSelectionRequest_encode(XSelectionRequest *self,
+	size_t maxbytes)
+{
+    if (!self->data) self->data = PSC_malloc(maxbytes ? maxbytes : 1);
+    if (self->proptype != XCB_ATOM_STRING)
+    {
+	return UniStr_utf8Chunk(self->text, &self->textpos,
+		self->data, maxbytes);
+    }
+    const char32_t *str = UniStr_str(self->text);
+    size_t len = UniStr_len(self->text) - self->textpos;
+    if (len > maxbytes) len = maxbytes;
+    char *latin1 = self->data;
+    for (size_t i = 0; i < len; ++i)
+    {
+	char32_t c = str[self->textpos++];
+	latin1[i] = c > 0xffU ? '?' : c;
+    }
+    return len;
+}
+
 static void XSelectionRequest_propertyChanged(
 	void *receiver, void *sender, void *args)
 {
@@ -306,7 +340,12 @@ static void XSelectionRequest_propertyChanged(
     uint32_t offset = self->datapos;
     if (self->propformat == 16) { chunksz >>= 1; offset <<= 1; }
     if (self->propformat == 32) { chunksz >>= 2; offset <<= 2; }
-    if (self->datalen - self->datapos < chunksz)
+    if (self->text)
+    {
+	chunksz = XSelectionRequest_encode(self, chunksz);
+	offset = 0;
+    }
+    else if (self->datalen - self->datapos < chunksz)
     {
 	chunksz = self->datalen - self->datapos;
     }
@@ -424,6 +463,7 @@ static void XSelectionRequest_start(XSelectionRequest *self)
     else
     {
 	self->sendincr = 0;
+	if (self->text) XSelectionRequest_encode(self, self->datalen);
 	AWAIT(xcb_change_property(c, XCB_PROP_MODE_REPLACE,
 		    self->requestor, self->property, self->proptype,
 		    self->propformat, self->datalen, self->data),
@@ -451,10 +491,12 @@ static XSelectionRequest *XSelectionRequest_create(XSelection *selection,
 	self->parent = parent;
 	self->subreqs = 0;
 	self->timeout = 0;
+	self->text = 0;
+	self->data = 0;
+	self->textpos = 0;
 	if (ev->target == A(MULTIPLE))
 	{
 	    notify = 0;
-	    self->data = 0;
 	    self->datalen = 0;
 	    self->proptype = A(ATOM_PAIR);
 	    self->propformat = 32;
@@ -500,15 +542,15 @@ static XSelectionRequest *XSelectionRequest_create(XSelection *selection,
 	}
 	else if (ev->target == XCB_ATOM_STRING)
 	{
-	    self->data = UniStr_toLatin1(selection->content.data);
-	    self->datalen = UniStr_len(selection->content.data);
+	    self->text = UniStr_ref(selection->content.data);
+	    self->datalen = UniStr_len(self->text);
 	    self->proptype = XCB_ATOM_STRING;
 	    self->propformat = 8;
 	}
 	else if (ev->target == A(TEXT) || ev->target == A(UTF8_STRING))
 	{
-	    self->data = UniStr_toUtf8(selection->content.data,
-		    &self->datalen);
+	    self->text = UniStr_ref(selection->content.data);
+	    self->datalen = UniStr_utf8len(self->text);
 	    self->proptype = A(UTF8_STRING);
 	    self->propformat = 8;
 	}
@@ -646,7 +688,7 @@ static void XSelectionConvert_done(XSelectionConvert *self, int destroy)
 	PSC_Event_unregister(Window_propertyChanged(self->selection->w),
 		self, XSelectionConvert_readIncr, self->property);
     }
-    free(self->data);
+    UniStrBuilder_destroy(self->text);
     if (destroy)
     {
 	free(self);
@@ -676,6 +718,41 @@ static void XSelectionConvert_readIncr(
     XSelectionConvert_notify(self);
 }
 
+/* Received chunks are decoded right away, an incomplete UTF-8 sequence at
+ * the end of a chunk is kept for the next one. Anything beyond the maximum
+ * length is dropped, but the transfer still runs to its end. */
+static void XSelectionConvert_decode(XSelectionConvert *self,
+	const char *data, size_t len)
+{
+    if (!self->text) self->text = UniStrBuilder_create();
+    size_t textlen = UniStr_len(UniStrBuilder_stringView(self->text));
+    size_t maxlen = self->selection->maxlen;
+    if (textlen >= maxlen) return;
+    if (self->proptype == XCB_ATOM_STRING)
+    {
+	if (len > maxlen - textlen) len = maxlen - textlen;
+	UniStrBuilder_appendLatin1(self->text, data, len);
+	return;
+    }
+    while (self->npending && len)
+    {
+	self->pending[self->npending++] = *data++;
+	--len;
+	size_t used = UniStrBuilder_appendUtf8(self->text,
+		self->pending, self->npending);
+	memmove(self->pending, self->pending + used, self->npending - used);
+	self->npending -= used;
+    }
+    size_t used = UniStrBuilder_appendUtf8(self->text, data, len);
+    memcpy(self->pending + self->npending, data + used, len - used);
+    self->npending += len - used;
+    textlen = UniStr_len(UniStrBuilder_stringView(self->text));
+    if (textlen > maxlen)
+    {
+	UniStrBuilder_remove(self->text, maxlen, textlen - maxlen);
+    }
+}
+
 static void XSelectionConvert_readProperty(void *obj, unsigned sequence,
 	void *reply, xcb_generic_error_t *error)
 {
@@ -743,58 +820,18 @@ static void XSelectionConvert_readProperty(void *obj, unsigned sequence,
 	}
 	self->proptype = prop->type;
     }
-    void *data = 0;
-    uint32_t datalen = 0;
     uint32_t receivedbytes = len;
     if (prop->format == 16) receivedbytes <<= 1;
     if (prop->format == 32) receivedbytes <<= 2;
-    if (self->recvincr)
-    {
-	if (len == 0)
-	{
-	    data = self->data;
-	    datalen = self->datalen;
-	}
-	else
-	{
-	    self->data = PSC_realloc(self->data,
-		    self->datalen + receivedbytes + 1);
-	    memcpy((char *)self->data + self->datalen,
-		    xcb_get_property_value(prop), receivedbytes);
-	    self->datalen += receivedbytes;
-	}
-    }
-    else
-    {
-	data = xcb_get_property_value(prop);
-	datalen = receivedbytes;
-    }
-    if (!data) return;
-    if (self->proptype == A(UTF8_STRING))
-    {
-	char *utf8 = 0;
-	if (self->data) utf8 = self->data;
-	else
-	{
-	    utf8 = PSC_malloc(datalen+1);
-	    memcpy(utf8, data, len);
-	}
-	utf8[datalen] = 0;
-	UniStr *str = UniStr_create(utf8);
-	if (!self->data) free(utf8);
-	self->received(self->requestor, (XSelectionContent){str, XST_TEXT});
-	UniStr_destroy(str);
-	XSelectionConvert_done(self, 0);
-	return;
-    }
-    if (self->proptype == XCB_ATOM_STRING)
-    {
-	UniStr *str = UniStr_createFromLatin1(data, datalen);
-	self->received(self->requestor, (XSelectionContent){str, XST_TEXT});
-	UniStr_destroy(str);
-	XSelectionConvert_done(self, 0);
-	return;
-    }
+    XSelectionConvert_decode(self, xcb_get_property_value(prop),
+	    receivedbytes);
+    if (self->recvincr && receivedbytes) return;
+    if (self->npending) UniStrBuilder_appendChar(self->text, 0xfffdU);
+    UniStr *str = UniStrBuilder_string(self->text);
+    self->received(self->requestor, (XSelectionContent){str, XST_TEXT});
+    UniStr_destroy(str);
+    XSelectionConvert_done(self, 0);
+    return;
 
 failed:
     PSC_Log_fmt(PSC_L_DEBUG, "Reading selection failed for %s",
@@ -871,6 +908,9 @@ XSelection *XSelection_create(Window *w, XSelectionName name)
     self->name = nameatom;
     self->maxproplen = X11Adapter_maxRequestSize()
 	- sizeof(xcb_change_property_request_t);
+    self->maxlen = XRdb_int(X11Adapter_resources(),
+	    XRdbKey(Widget_resname(w), "selectionMaxLength"),
+	    XRQF_OVERRIDES, DEFMAXLEN, 1, MAXMAXLEN);
     PSC_Event_register(Window_propertyChanged(w), self,
 	    doOwnSelection, A(WM_CLASS));
     PSC_Event_register(X11Adapter_selectionClear(), self,
@@ -902,13 +942,13 @@ void XSelection_request(XSelection *self, XSelectionType type,
     conversion->next = 0;
     conversion->requestor = Object_ref(widget);
     conversion->timeout = PSC_Timer_create();
-    conversion->data = 0;
-    conversion->datalen = 0;
+    conversion->text = 0;
     conversion->received = received;
     conversion->type = type;
     conversion->property = property;
     conversion->proptype = 0;
     conversion->target = 0;
+    conversion->npending = 0;
     conversion->recvincr = 0;
 
     if (self->conversions)
@@ -978,6 +1018,25 @@ void XSelection_publish(XSelection *self, Widget *owner,
     }
 }
 
+void XSelection_release(XSelection *self, Widget *owner)
+{
+    if (self->newOwner == owner)
+    {
+	if (self->newContent.type == XST_TEXT)
+	{
+	    UniStr_destroy(self->newContent.data);
+	}
+	self->newOwner = 0;
+	self->newContent = NOCONTENT;
+    }
+    if (!owner || self->owner != owner) return;
+    CHECK(xcb_set_selection_owner(X11Adapter_connection(), XCB_NONE,
+		self->name, self->ownedTime),
+	    "Cannot release selection ownership for 0x%x",
+	    (unsigned)Window_id(self->w));
+    clearSelection(self);
+}
+
 void XSelection_destroy(XSelection *self)
 {
     if (!self) return;
@@ -35,6 +35,8 @@ void XSelection_request(XSelection *self, XSelectionType type,
 void XSelection_publish(XSelection *self, Widget *owner,
 	XSelectionContent content)
     CMETHOD;
+void XSelection_release(XSelection *self, Widget *owner)
+    CMETHOD;
 void XSelection_destroy(XSelection *self);
 
 #endif
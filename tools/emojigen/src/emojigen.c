@@ -16,6 +16,7 @@ int main(int argc, char **argv)
     if (!strcmp(argv[1], "groupnames")) return dogroupnames(argc, argv);
     if (!strcmp(argv[1], "emojinames")) return doemojinames(argc, argv);
     if (!strcmp(argv[1], "translate")) return dotranslate(argc, argv);
+    if (!strcmp(argv[1], "keywords")) return dokeywords(argc, argv);
     usage(name);
 }
 
@@ -3,6 +3,7 @@
 #include "emojireader.h"
 #include "util.h"
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -76,7 +77,7 @@ static size_t fromutf8(char32_t *ucs4, size_t sz, const char *utf8)
 #define skipws(c) do { while (isws(c)) ++c; } while (0)
 #define match(c, s) (!strncmp((c), (s), sizeof(s)-1) ? ((c)+=sizeof(s)-1) : 0)
 
-static void readTranslations(TranslationBucket *buckets, FILE *in)
+static void readTranslations(TranslationBucket *buckets, FILE *in, int tts)
 {
     static char line[1024];
     static char utf8[48];
@@ -98,7 +99,8 @@ static void readTranslations(TranslationBucket *buckets, FILE *in)
 	utf8[utf8len] = 0;
 	c = e+1;
 	skipws(c);
-	if (!match(c, "type=\"tts\"")) continue;
+	int istts = !!match(c, "type=\"tts\"");
+	if (istts != tts) continue;
 	skipws(c);
 	if (match(c, "draft=\"contributed\"")) skipws(c);
 	if (*c != '>') continue;
@@ -200,7 +202,10 @@ int dotranslate(int argc, char **argv)
 	goto done;
     }
 
-    for (int i = 0; i < argc - 4; ++i) readTranslations(translations, in[i]);
+    for (int i = 0; i < argc - 4; ++i)
+    {
+	readTranslations(translations, in[i], 1);
+    }
 
     size_t emojisize = Emoji_count();
     for (size_t i = 0; i < emojisize; ++i)
@@ -231,3 +236,363 @@ done:
     return rc;
 }
 
+
+#define KWMAGIC "XKW"
+#define KWVERSION 1
+#define KWHEADERSZ 16
+#define KWSLOTSZ 16
+#define KWMAXDISP 0xffffffU
+
+/* XKW v1 layout, all values 32bit little endian:
+ *
+ *   "XKW" 0x01, number of keywords n, number of buckets m, reserved 0
+ *   m displacements
+ *   n slots: keyword offset, keyword length, emojis offset, emojis count
+ *   blob of UTF-32 keywords and lists of emoji indices
+ *
+ * A keyword is found in bucket kwhash(keyword, 0) % m, its slot is
+ * kwhash(keyword, displacement) % n, so every lookup is a single probe.
+ * The runtime must use exactly the same kwhash() and folding. */
+
+typedef struct Keyword
+{
+    char32_t *str;
+    size_t len;
+    unsigned *emojis;
+    size_t nemojis;
+    size_t emojiscapa;
+    unsigned slot;
+} Keyword;
+
+typedef struct KeywordBucket
+{
+    size_t *keywords;
+    size_t len;
+    size_t capa;
+    unsigned index;
+} KeywordBucket;
+
+static uint32_t kwhash(const char32_t *s, size_t len, uint32_t seed)
+{
+    uint32_t h = 2166136261U ^ (seed * 0x9e3779b9U);
+    for (size_t i = 0; i < len; ++i)
+    {
+	h ^= (uint32_t)s[i];
+	h *= 16777619U;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    return h;
+}
+
+static char32_t isolc(char32_t c)
+{
+    if ((c >= 0x41 && c <= 0x5a)
+	    || (c >= 0xc0 && c <= 0xd6)
+	    || (c >= 0xd8 && c <= 0xde)) return c + 0x20;
+    return c;
+}
+
+static Keyword *keywords;
+static size_t nkeywords;
+static size_t keywordscapa;
+static size_t *kwindex;
+static size_t kwindexsz;
+
+static Keyword *getKeyword(const char32_t *str, size_t len)
+{
+    if (!kwindexsz)
+    {
+	kwindexsz = 1 << 14;
+	kwindex = xmalloc(kwindexsz * sizeof *kwindex);
+	memset(kwindex, 0, kwindexsz * sizeof *kwindex);
+    }
+    size_t pos = kwhash(str, len, 0) & (kwindexsz - 1);
+    while (kwindex[pos])
+    {
+	Keyword *kw = keywords + kwindex[pos] - 1;
+	if (kw->len == len && !memcmp(kw->str, str, len * sizeof *str))
+	{
+	    return kw;
+	}
+	pos = (pos + 1) & (kwindexsz - 1);
+    }
+    if ((nkeywords + 1) * 2 > kwindexsz)
+    {
+	free(kwindex);
+	kwindexsz <<= 1;
+	kwindex = xmalloc(kwindexsz * sizeof *kwindex);
+	memset(kwindex, 0, kwindexsz * sizeof *kwindex);
+	for (size_t i = 0; i < nkeywords; ++i)
+	{
+	    size_t p = kwhash(keywords[i].str, keywords[i].len, 0)
+		& (kwindexsz - 1);
+	    while (kwindex[p]) p = (p + 1) & (kwindexsz - 1);
+	    kwindex[p] = i + 1;
+	}
+	return getKeyword(str, len);
+    }
+    if (nkeywords == keywordscapa)
+    {
+	keywordscapa += 1024;
+	keywords = xrealloc(keywords, keywordscapa * sizeof *keywords);
+    }
+    Keyword *kw = keywords + nkeywords++;
+    kw->str = xmalloc(len * sizeof *kw->str);
+    memcpy(kw->str, str, len * sizeof *str);
+    kw->len = len;
+    kw->emojis = 0;
+    kw->nemojis = 0;
+    kw->emojiscapa = 0;
+    kwindex[pos] = nkeywords;
+    return kw;
+}
+
+static void addKeywords(const char *text, unsigned emoji)
+{
+    static char utf8[256];
+    static char32_t ucs4[128];
+
+    while (*text)
+    {
+	const char *e = text;
+	while (*e && *e != '|') ++e;
+	const char *end = e;
+	while (*text == ' ') ++text;
+	while (end > text && end[-1] == ' ') --end;
+	size_t utf8len = (size_t)(end - text);
+	if (utf8len && utf8len < sizeof utf8)
+	{
+	    memcpy(utf8, text, utf8len);
+	    utf8[utf8len] = 0;
+	    size_t len = fromutf8(ucs4, sizeof ucs4 / sizeof *ucs4, utf8);
+	    if (len--)
+	    {
+		for (size_t i = 0; i < len; ++i) ucs4[i] = isolc(ucs4[i]);
+		Keyword *kw = getKeyword(ucs4, len);
+		if (!kw->nemojis || kw->emojis[kw->nemojis - 1] != emoji)
+		{
+		    if (kw->nemojis == kw->emojiscapa)
+		    {
+			kw->emojiscapa += 8;
+			kw->emojis = xrealloc(kw->emojis,
+				kw->emojiscapa * sizeof *kw->emojis);
+		    }
+		    kw->emojis[kw->nemojis++] = emoji;
+		}
+	    }
+	}
+	text = *e ? e + 1 : e;
+    }
+}
+
+static int cmpbuckets(const void *a, const void *b)
+{
+    const KeywordBucket *ba = a;
+    const KeywordBucket *bb = b;
+    if (ba->len != bb->len) return ba->len < bb->len ? 1 : -1;
+    return ba->index < bb->index ? -1 : ba->index > bb->index;
+}
+
+static int buildhash(uint32_t *disp, size_t m)
+{
+    size_t n = nkeywords;
+    int rc = -1;
+    KeywordBucket *buckets = xmalloc(m * sizeof *buckets);
+    memset(buckets, 0, m * sizeof *buckets);
+    unsigned char *used = xmalloc(n);
+    memset(used, 0, n);
+    unsigned *slots = 0;
+    for (size_t b = 0; b < m; ++b) buckets[b].index = b;
+    for (size_t i = 0; i < n; ++i)
+    {
+	KeywordBucket *bucket = buckets
+	    + kwhash(keywords[i].str, keywords[i].len, 0) % m;
+	if (bucket->len == bucket->capa)
+	{
+	    bucket->capa += 4;
+	    bucket->keywords = xrealloc(bucket->keywords,
+		    bucket->capa * sizeof *bucket->keywords);
+	}
+	bucket->keywords[bucket->len++] = i;
+    }
+    qsort(buckets, m, sizeof *buckets, cmpbuckets);
+
+    for (size_t b = 0; b < m && buckets[b].len; ++b)
+    {
+	KeywordBucket *bucket = buckets + b;
+	slots = xrealloc(slots, bucket->len * sizeof *slots);
+	uint32_t d;
+	for (d = 1; d <= KWMAXDISP; ++d)
+	{
+	    size_t k;
+	    for (k = 0; k < bucket->len; ++k)
+	    {
+		const Keyword *kw = keywords + bucket->keywords[k];
+		slots[k] = kwhash(kw->str, kw->len, d) % n;
+		if (used[slots[k]]) break;
+		size_t j;
+		for (j = 0; j < k; ++j) if (slots[j] == slots[k]) break;
+		if (j < k) break;
+	    }
+	    if (k == bucket->len) break;
+	}
+	if (d > KWMAXDISP) goto done;
+	disp[bucket->index] = d;
+	for (size_t k = 0; k < bucket->len; ++k)
+	{
+	    used[slots[k]] = 1;
+	    keywords[bucket->keywords[k]].slot = slots[k];
+	}
+    }
+    rc = 0;
+
+done:
+    for (size_t b = 0; b < m; ++b) free(buckets[b].keywords);
+    free(buckets);
+    free(used);
+    free(slots);
+    return rc;
+}
+
+static void put32le(unsigned char *data, uint32_t val)
+{
+    data[0] = val & 0xff;
+    data[1] = (val >> 8) & 0xff;
+    data[2] = (val >> 16) & 0xff;
+    data[3] = (val >> 24) & 0xff;
+}
+
+static void write32le(FILE *out, uint32_t val)
+{
+    unsigned char data[4];
+    put32le(data, val);
+    fwrite(data, sizeof data, 1, out);
+}
+
+static int writeKeywords(FILE *out)
+{
+    size_t n = nkeywords;
+    size_t m = n / 4 + 1;
+    uint32_t *disp = xmalloc(m * sizeof *disp);
+    memset(disp, 0, m * sizeof *disp);
+    unsigned char *slots = 0;
+    int rc = -1;
+    if (n && buildhash(disp, m) < 0) goto done;
+
+    slots = xmalloc(n * KWSLOTSZ + 1);
+    size_t offset = KWHEADERSZ + m * 4 + n * KWSLOTSZ;
+    for (size_t i = 0; i < n; ++i)
+    {
+	const Keyword *kw = keywords + i;
+	unsigned char *slot = slots + kw->slot * KWSLOTSZ;
+	put32le(slot, offset);
+	put32le(slot + 4, kw->len);
+	offset += kw->len * 4;
+	put32le(slot + 8, offset);
+	put32le(slot + 12, kw->nemojis);
+	offset += kw->nemojis * 4;
+    }
+
+    fprintf(out, KWMAGIC "%c", KWVERSION);
+    write32le(out, n);
+    write32le(out, m);
+    write32le(out, 0);
+    for (size_t b = 0; b < m; ++b) write32le(out, disp[b]);
+    if (n) fwrite(slots, KWSLOTSZ, n, out);
+    for (size_t i = 0; i < n; ++i)
+    {
+	const Keyword *kw = keywords + i;
+	for (size_t j = 0; j < kw->len; ++j) write32le(out, kw->str[j]);
+	for (size_t j = 0; j < kw->nemojis; ++j) write32le(out, kw->emojis[j]);
+    }
+    rc = 0;
+
+done:
+    free(slots);
+    free(disp);
+    return rc;
+}
+
+int dokeywords(int argc, char **argv)
+{
+    if (argc < 5) usage(argv[0]);
+    int rc = EXIT_FAILURE;
+    FILE *out = 0;
+    FILE *in[16] = { 0 };
+    TranslationBucket annotations[1024] = { {0, 0, 0} };
+
+    if (argc - 4 > (int)(sizeof in / sizeof *in))
+    {
+	fputs("Too many input files given\n", stderr);
+	goto done;
+    }
+    if (readEmojis(argv[3]) < 0)
+    {
+	fprintf(stderr, "Cannot read emojis from `%s'\n", argv[3]);
+	goto done;
+    }
+    for (int i = 0; i < argc - 4; ++i)
+    {
+	in[i] = fopen(argv[i+4], "r");
+	if (!in[i])
+	{
+	    fprintf(stderr, "Cannot open `%s' for reading\n", argv[i+4]);
+	    goto done;
+	}
+    }
+    out = fopen(argv[2], "wb");
+    if (!out)
+    {
+	fprintf(stderr, "Cannot open `%s' for writing\n", argv[2]);
+	goto done;
+    }
+
+    for (int i = 0; i < argc - 4; ++i)
+    {
+	readTranslations(annotations, in[i], 0);
+    }
+
+    size_t emojisize = Emoji_count();
+    for (size_t i = 0; i < emojisize; ++i)
+    {
+	const Emoji *emoji = Emoji_at(i);
+	if (!emoji->variants) continue;
+	const char *text = gettranslation(annotations, emoji);
+	if (text) addKeywords(text, i);
+    }
+    if (writeKeywords(out) < 0)
+    {
+	fputs("Cannot build keyword hash\n", stderr);
+    }
+    else if (ferror(out))
+    {
+	fprintf(stderr, "Error writing to `%s'\n", argv[2]);
+    }
+    else rc = EXIT_SUCCESS;
+
+done:
+    for (size_t i = 0; i < sizeof annotations / sizeof *annotations; ++i)
+    {
+	if (!annotations[i].size) continue;
+	for (size_t j = 0; j < annotations[i].size; ++j)
+	{
+	    free(annotations[i].entries[j]->text);
+	    free(annotations[i].entries[j]->emoji);
+	    free(annotations[i].entries[j]);
+	}
+	free(annotations[i].entries);
+    }
+    for (size_t i = 0; i < nkeywords; ++i)
+    {
+	free(keywords[i].str);
+	free(keywords[i].emojis);
+    }
+    free(keywords);
+    free(kwindex);
+    if (out) fclose(out);
+    for (int i = 0; i < argc -4; ++i) if (in[i]) fclose(in[i]);
+    emojisDone();
+    return rc;
+}
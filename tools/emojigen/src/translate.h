@@ -2,5 +2,6 @@
 #define EMOJIGEN_TRANSLATE_H
 
 int dotranslate(int argc, char **argv);
+int dokeywords(int argc, char **argv);
 
 #endif
@@ -8,19 +8,101 @@
 #include <string.h>
 
 #define MAGIC "XCT"
-#define VERSION 0
+#define VERSION 1
+#define HEADERSZ 16
+#define ENTRYSZ 12
+#define NOENTRY 0xffffffffU
+
+/* XCT v1 layout, all values 32bit little endian:
+ *
+ *   "XCT" 0x01, number of entries, byte order mark 0xfeff, reserved 0
+ *   per entry: type (NOENTRY if untranslated), length, offset from start
+ *   string blob
+ *
+ * DT_CHAR strings are stored as UTF-8, DT_CHAR32 strings as UTF-32, both
+ * NUL-terminated and starting at 4-byte aligned offsets, so they can be
+ * used directly from a memory mapping of the file. */
+
+typedef struct Blob
+{
+    unsigned char *data;
+    size_t len;
+    size_t capa;
+} Blob;
+
+static void put32le(unsigned char *data, unsigned val)
+{
+    data[0] = val & 0xff;
+    data[1] = (val >> 8) & 0xff;
+    data[2] = (val >> 16) & 0xff;
+    data[3] = (val >> 24) & 0xff;
+}
 
 static void write32le(FILE *out, unsigned val)
 {
-    unsigned char data[4] = {
-	val & 0xff,
-	(val >> 8) & 0xff,
-	(val >> 16) & 0xff,
-	(val >> 24) & 0xff
-    };
+    unsigned char data[4];
+    put32le(data, val);
     fwrite(data, sizeof data, 1, out);
 }
 
+static unsigned char *reserve(Blob *blob, size_t len)
+{
+    if (blob->len + len > blob->capa)
+    {
+	while (blob->len + len > blob->capa) blob->capa += 4096;
+	blob->data = xrealloc(blob->data, blob->capa);
+    }
+    unsigned char *pos = blob->data + blob->len;
+    blob->len += len;
+    return pos;
+}
+
+static void align(Blob *blob)
+{
+    while (blob->len & 3U) *reserve(blob, 1) = 0;
+}
+
+static unsigned utf8toutf32(Blob *blob, const char *str)
+{
+    const unsigned char *b = (const unsigned char *)str;
+    unsigned len = 0;
+    while (*b)
+    {
+	unsigned c = *b++;
+	int follow = 0;
+	if ((c & 0xf8U) == 0xf0U)
+	{
+	    c &= 0x07U;
+	    follow = 3;
+	}
+	else if ((c & 0xf0U) == 0xe0U)
+	{
+	    c &= 0x0fU;
+	    follow = 2;
+	}
+	else if ((c & 0xe0U) == 0xc0U)
+	{
+	    c &= 0x1fU;
+	    follow = 1;
+	}
+	else if (c >= 0x80U) c = 0xfffdU;
+	while (follow--)
+	{
+	    if ((*b & 0xc0U) != 0x80U)
+	    {
+		c = 0xfffdU;
+		break;
+	    }
+	    c = (c << 6) | (*b++ & 0x3fU);
+	}
+	if (c > 0x10ffffU) c = 0xfffdU;
+	put32le(reserve(blob, 4), c);
+	++len;
+    }
+    put32le(reserve(blob, 4), 0);
+    return len;
+}
+
 int docompile(int argc, char **argv)
 {
     if (argc != 5) usage(argv[0]);
@@ -32,6 +114,8 @@ int docompile(int argc, char **argv)
     DefFile *df = 0;
     DefFile *ldf = 0;
     FILE *out = 0;
+    unsigned char *table = 0;
+    Blob blob = { 0, 0, 0 };
 
     df = DefFile_create(defname);
     if (!df)
@@ -52,24 +136,45 @@ int docompile(int argc, char **argv)
 	goto done;
     }
 
-    fprintf(out, MAGIC "%c", VERSION);
     unsigned len = DefFile_len(df);
-    write32le(out, len);
+    size_t blobstart = HEADERSZ + (size_t)len * ENTRYSZ;
+    table = xmalloc((size_t)len * ENTRYSZ + 1);
     for (unsigned i = 0; i < len; ++i)
     {
 	const DefEntry *entry = DefFile_byId(df, i);
 	const DefEntry *lentry = DefFile_byKey(ldf, DefEntry_key(entry));
 	const char *str = 0;
 	if (lentry) str = DefEntry_to(lentry);
+	unsigned char *tentry = table + (size_t)i * ENTRYSZ;
 	if (str)
 	{
-	    fputc(DefEntry_type(entry), out);
-	    unsigned slen = (unsigned)strlen(str);
-	    write32le(out, slen);
-	    fwrite(str, 1, slen, out);
+	    DefType type = DefEntry_type(entry);
+	    unsigned slen;
+	    put32le(tentry, type);
+	    put32le(tentry + 8, (unsigned)(blobstart + blob.len));
+	    if (type == DT_CHAR32) slen = utf8toutf32(&blob, str);
+	    else
+	    {
+		slen = (unsigned)strlen(str);
+		memcpy(reserve(&blob, slen + 1), str, slen + 1);
+		align(&blob);
+	    }
+	    put32le(tentry + 4, slen);
+	}
+	else
+	{
+	    put32le(tentry, NOENTRY);
+	    put32le(tentry + 4, 0);
+	    put32le(tentry + 8, 0);
 	}
-	else fputc(-1, out);
     }
+
+    fprintf(out, MAGIC "%c", VERSION);
+    write32le(out, len);
+    write32le(out, 0xfeffU);
+    write32le(out, 0);
+    fwrite(table, ENTRYSZ, len, out);
+    if (blob.len) fwrite(blob.data, 1, blob.len, out);
     if (ferror(out))
     {
 	fprintf(stderr, "Error writing to `%s'\n", xctname);
@@ -78,6 +183,8 @@ int docompile(int argc, char **argv)
 
 done:
     if (out) fclose(out);
+    free(blob.data);
+    free(table);
     DefFile_destroy(ldf);
     DefFile_destroy(df);
     return rc;